@@ -0,0 +1,56 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __KEYWORD_H__
+#define __KEYWORD_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * Keywords are resolved through a perfect hash table that mkkeywords
+ * generates from keywords.def at build time. A token is hashed over all its
+ * bytes with FNV-1a started from a seed, and mkkeywords tries seeds until no
+ * two keywords share a slot. Thus a lookup is a single probe and a single
+ * comparison however many keywords there are, and tokens longer than any
+ * keyword are turned down without being hashed.
+ *
+ * With @nocase, the bytes are folded so that keywords match in any case.
+ */
+struct keyword_slot {
+	const char *keyword;
+	unsigned int len;	/* 0 for empty slots */
+	int op;
+};
+
+static inline uint32_t keyword_hash(const char *token, size_t len, int nocase,
+		uint32_t seed)
+{
+	unsigned char fold = nocase ? 0x20 : 0x00;
+	uint32_t hash = 2166136261U ^ seed;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (unsigned char)(token[i] | fold);
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static inline unsigned int keyword_slot(uint32_t hash, unsigned int bits)
+{
+	return (uint32_t)(hash * 0x9e3779b9U) >> (32 - bits);
+}
+
+#endif
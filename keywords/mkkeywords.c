@@ -0,0 +1,235 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "keyword.h"
+
+/**
+ * Generate the perfect hash table of keywords (see keyword.h).
+ *
+ * Each line of the definition read from stdin names an opcode followed by
+ * the keywords for it. Blank lines and lines starting with '#' are ignored.
+ *
+ *	KW_HELP		help ?
+ *
+ * The header defining enum keyword and keyword_lookup() is written to stdout.
+ */
+#define MAX_KEYWORDS	256
+#define MAX_OPS		MAX_KEYWORDS
+#define MAX_BITS	16
+#define MAX_TRIALS	(1 << 16)
+
+static struct {
+	char *keyword;
+	size_t len;
+	int op;
+} keywords[MAX_KEYWORDS];
+static int nr_keywords = 0;
+static size_t max_len = 0;
+
+static char *ops[MAX_OPS];
+static int nr_ops = 0;
+
+static bool nocase = false;
+
+static int __add_op(const char *name)
+{
+	for (int i = 0; i < nr_ops; i++) {
+		if (strcmp(ops[i], name) == 0) return i;
+	}
+	if (nr_ops == MAX_OPS) return -1;
+
+	ops[nr_ops] = strdup(name);
+	return nr_ops++;
+}
+
+static int __add_keyword(const char *keyword, int op, int lineno)
+{
+	size_t len = strlen(keyword);
+
+	for (int i = 0; i < nr_keywords; i++) {
+		if (len == keywords[i].len &&
+				(nocase ? strncasecmp : strncmp)(keyword,
+					keywords[i].keyword, len) == 0) {
+			fprintf(stderr, "%d: Duplicate keyword %s\n", lineno, keyword);
+			return -1;
+		}
+	}
+	if (nr_keywords == MAX_KEYWORDS || len > 0xff) {
+		fprintf(stderr, "%d: Too many or too long keywords\n", lineno);
+		return -1;
+	}
+
+	keywords[nr_keywords].keyword = strdup(keyword);
+	keywords[nr_keywords].len = len;
+	keywords[nr_keywords].op = op;
+	nr_keywords++;
+	if (len > max_len) max_len = len;
+
+	return 0;
+}
+
+static int __load(FILE *input)
+{
+	char line[1024];
+	int lineno = 0;
+
+	while (fgets(line, sizeof(line), input)) {
+		char *token = strtok(line, " \t\r\n");
+		int op;
+
+		lineno++;
+		if (!token || token[0] == '#') continue;
+
+		op = __add_op(token);
+		if (op < 0) return -1;
+
+		if (!(token = strtok(NULL, " \t\r\n"))) {
+			fprintf(stderr, "%d: No keyword for %s\n", lineno, ops[op]);
+			return -1;
+		}
+		for (; token; token = strtok(NULL, " \t\r\n")) {
+			if (__add_keyword(token, op, lineno)) return -1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Find the seed and the number of bits that make the keywords collision-free.
+ * Seeds are drawn from a fixed sequence so that the output is reproducible.
+ */
+static bool __find_seed(uint32_t *seed, unsigned int *bits)
+{
+	unsigned int b = 1;
+
+	while ((1 << b) < nr_keywords * 2) b++;
+
+	for (; b <= MAX_BITS; b++) {
+		uint32_t s = 0x9e3779b9;
+
+		for (int trial = 0; trial < MAX_TRIALS; trial++) {
+			static unsigned char used[1 << MAX_BITS];
+			bool collision = false;
+
+			s = s * 1664525 + 1013904223;
+			memset(used, 0x00, 1 << b);
+
+			for (int i = 0; i < nr_keywords && !collision; i++) {
+				unsigned int slot = keyword_slot(keyword_hash(
+						keywords[i].keyword, keywords[i].len,
+						nocase, s), b);
+
+				collision = used[slot];
+				used[slot] = 1;
+			}
+			if (!collision) {
+				*seed = s;
+				*bits = b;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+static void __generate(uint32_t seed, unsigned int bits)
+{
+	printf("/* Generated by mkkeywords. DO NOT EDIT */\n");
+	printf("\n");
+	printf("#ifndef __KEYWORDS_H__\n");
+	printf("#define __KEYWORDS_H__\n");
+	printf("\n");
+	printf("#include <string.h>\n");
+	printf("#include <strings.h>\n");
+	printf("\n");
+	printf("#include \"keyword.h\"\n");
+	printf("\n");
+
+	printf("enum keyword {\n");
+	printf("\tKW_NONE = 0,\n");
+	for (int i = 0; i < nr_ops; i++) {
+		printf("\t%s,\n", ops[i]);
+	}
+	printf("\tNR_KEYWORDS,\n");
+	printf("};\n");
+	printf("\n");
+
+	printf("static const struct keyword_slot __keywords[%u] = {\n", 1 << bits);
+	for (int i = 0; i < nr_keywords; i++) {
+		printf("\t[%u] = { \"%s\", %zu, %s },\n",
+				keyword_slot(keyword_hash(keywords[i].keyword,
+						keywords[i].len, nocase, seed), bits),
+				keywords[i].keyword, keywords[i].len,
+				ops[keywords[i].op]);
+	}
+	printf("};\n");
+	printf("\n");
+
+	printf("static inline enum keyword keyword_lookup(const char *token, size_t len)\n");
+	printf("{\n");
+	printf("\tconst struct keyword_slot *slot;\n");
+	printf("\n");
+	printf("\tif (len == 0 || len > %zu) return KW_NONE;\n", max_len);
+	printf("\n");
+	printf("\tslot = __keywords + keyword_slot(keyword_hash(token, len, %d, %#xU), %u);\n",
+			nocase, seed, bits);
+	printf("\tif (slot->len != len || %s(token, slot->keyword, len)) return KW_NONE;\n",
+			nocase ? "strncasecmp" : "memcmp");
+	printf("\n");
+	printf("\treturn slot->op;\n");
+	printf("}\n");
+	printf("\n");
+	printf("#endif\n");
+}
+
+int main(int argc, char * const argv[])
+{
+	int opt;
+	uint32_t seed;
+	unsigned int bits;
+
+	while ((opt = getopt(argc, argv, "i")) != -1) {
+		switch (opt) {
+		case 'i':
+			nocase = true;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s {-i} < keywords.def > keywords.h\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (__load(stdin)) return EXIT_FAILURE;
+	if (nr_keywords == 0) {
+		fprintf(stderr, "No keyword is defined\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!__find_seed(&seed, &bits)) {
+		fprintf(stderr, "Unable to find a perfect hash for the keywords\n");
+		return EXIT_FAILURE;
+	}
+
+	__generate(seed, bits);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,319 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "types.h"
+#include "classify.h"
+
+/**
+ * Batch tokenizer. The input file is mapped and tokenized in one pass in the
+ * same way as pa0 tokenizes each line, and the tokens are printed as pa0 does.
+ * Unlike reading the file line by line, neither the length of lines nor the
+ * number of tokens is limited.
+ *
+ * Usage: pa0-batch [input file]
+ *  The input is tokenized from the current position of stdin when no file is
+ *  given. Either way it has to be a regular file.
+ */
+
+/**
+ * Token index of an entire input file. The file is mapped read-only and the
+ * tokens are not terminated with '\0'; use @token_len[] to get the extent of
+ * each token. Tokens of line @l are in [@line_start[l], @line_start[l + 1]).
+ */
+struct parsed_file {
+	const char *data;	/* The mapping followed by '\0' */
+	size_t begin;		/* Offset of the input in @data */
+	size_t size;		/* End of the input in @data */
+	size_t map_size;
+
+	size_t nr_lines;
+	size_t nr_tokens;
+
+	size_t *line_start;	/* Index of the first token of each line */
+	size_t *token_offset;	/* Offset of each token in @data */
+	unsigned int *token_len;/* Length of each token */
+
+	size_t __lines_capacity;
+	size_t __tokens_capacity;
+};
+
+static void __classify_scalar(const char *block, struct block_class *c)
+{
+	c->space = c->quote = c->newline = c->nul = 0;
+
+	for (int i = 0; i < BLOCK_SIZE; i++) {
+		if (isspace(block[i])) c->space |= 1ULL << i;
+		if (block[i] == '"') c->quote |= 1ULL << i;
+		if (block[i] == '\n') c->newline |= 1ULL << i;
+		if (block[i] == '\0') c->nul |= 1ULL << i;
+	}
+}
+
+static int __grow(void *array, size_t *capacity, size_t nr, size_t size)
+{
+	void *new;
+	size_t new_capacity = *capacity ? *capacity * 2 : 1024;
+
+	if (nr < *capacity) return 0;
+
+	new = realloc(*(void **)array, new_capacity * size);
+	if (!new) return -ENOMEM;
+
+	*(void **)array = new;
+	*capacity = new_capacity;
+	return 0;
+}
+
+static int __add_line(struct parsed_file *pf)
+{
+	if (__grow(&pf->line_start, &pf->__lines_capacity,
+				pf->nr_lines + 1, sizeof(*pf->line_start))) {
+		return -ENOMEM;
+	}
+	pf->line_start[++pf->nr_lines] = pf->nr_tokens;
+	return 0;
+}
+
+static int __add_token(struct parsed_file *pf, size_t offset)
+{
+	size_t capacity = pf->__tokens_capacity;
+
+	if (__grow(&pf->token_offset, &capacity,
+				pf->nr_tokens, sizeof(*pf->token_offset)) ||
+		__grow(&pf->token_len, &pf->__tokens_capacity,
+				pf->nr_tokens, sizeof(*pf->token_len))) {
+		return -ENOMEM;
+	}
+	pf->token_offset[pf->nr_tokens++] = offset;
+	return 0;
+}
+
+/**
+ * Walk the input in blocks as __parse_command_blocks() of pa0.c does, also
+ * stopping at newlines to split the index into lines. The input starts at
+ * @begin and @data is readable up to the BLOCK_SIZE-aligned end of @size + 1
+ * bytes; the bytes before @begin are loaded but masked out.
+ */
+static int __index_blocks(struct parsed_file *pf,
+		void (*classify)(const char *block, struct block_class *c))
+{
+	const char *data = pf->data;
+	enum { OUTSIDE, IN_TOKEN, IN_QUOTE } state = OUTSIDE;
+
+	if (__grow(&pf->line_start, &pf->__lines_capacity,
+				0, sizeof(*pf->line_start))) {
+		return -ENOMEM;
+	}
+	pf->line_start[0] = 0;
+
+	for (size_t base = pf->begin & ~(BLOCK_SIZE - 1); base < pf->size;
+			base += BLOCK_SIZE) {
+		struct block_class c;
+		uint64_t valid = ~0ULL;
+		uint64_t word, pending;
+
+		if (pf->size - base < BLOCK_SIZE) {
+			valid = (1ULL << (pf->size - base)) - 1;
+		}
+		if (base < pf->begin) valid &= ~0ULL << (pf->begin - base);
+
+		classify(data + base, &c);
+
+		word = ~c.space & valid;
+		c.newline &= valid;
+		pending = valid;
+
+		while (true) {
+			uint64_t next;
+			unsigned int i;
+			size_t pos;
+
+			if (state == OUTSIDE) {
+				next = (word | c.newline) & pending;
+			} else if (state == IN_TOKEN) {
+				next = ~word & pending;
+			} else {
+				next = (c.quote | c.newline) & pending;
+			}
+			if (!next) break;
+
+			i = __builtin_ctzll(next);
+			pending &= (~0ULL << i) << 1;
+			pos = base + i;
+
+			if (state != OUTSIDE) {
+				size_t t = pf->nr_tokens - 1;
+				pf->token_len[t] = pos - pf->token_offset[t];
+				state = OUTSIDE;
+			} else if (data[pos] == '"') {
+				if (__add_token(pf, pos + 1)) return -ENOMEM;
+				state = IN_QUOTE;
+			} else if (data[pos] != '\n') {
+				if (__add_token(pf, pos)) return -ENOMEM;
+				state = IN_TOKEN;
+			}
+
+			if (data[pos] == '\n') {
+				if (__add_line(pf)) return -ENOMEM;
+			}
+		}
+	}
+
+	/* The file does not end with a newline */
+	if (state != OUTSIDE) {
+		size_t t = pf->nr_tokens - 1;
+		pf->token_len[t] = pf->size - pf->token_offset[t];
+	}
+	if (pf->size > pf->begin && data[pf->size - 1] != '\n') {
+		if (__add_line(pf)) return -ENOMEM;
+	}
+
+	return 0;
+}
+
+/**
+ * Map the file from its current position with a trailing '\0' byte. The file
+ * is mapped from the page holding the position over an anonymous mapping one
+ * byte larger, so the byte after the file is readable even when the file ends
+ * at a page boundary.
+ */
+static int __map_file(int fd, struct parsed_file *pf)
+{
+	struct stat st;
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	off_t pos, start;
+	void *data;
+
+	if (fstat(fd, &st) < 0) return -errno;
+	if (!S_ISREG(st.st_mode)) return -EINVAL;
+
+	pos = lseek(fd, 0, SEEK_CUR);
+	if (pos < 0) return -errno;
+	if (pos > st.st_size) pos = st.st_size;
+	start = pos & ~(off_t)(page_size - 1);
+
+	pf->begin = pos - start;
+	pf->size = st.st_size - start;
+	pf->map_size = (pf->size + 1 + page_size - 1) & ~(page_size - 1);
+
+	data = mmap(NULL, pf->map_size, PROT_READ,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (data == MAP_FAILED) return -errno;
+
+	if (pf->size && mmap(data, pf->size, PROT_READ,
+				MAP_PRIVATE | MAP_FIXED, fd, start) == MAP_FAILED) {
+		int ret = -errno;
+		munmap(data, pf->map_size);
+		return ret;
+	}
+	madvise(data, pf->size, MADV_SEQUENTIAL);
+
+	/* The input is consumed as reading it would */
+	lseek(fd, st.st_size, SEEK_SET);
+
+	pf->data = data;
+	return 0;
+}
+
+static void free_parsed_file(struct parsed_file *pf)
+{
+	if (pf->data) munmap((void *)pf->data, pf->map_size);
+
+	free(pf->line_start);
+	free(pf->token_offset);
+	free(pf->token_len);
+
+	*pf = (struct parsed_file) { 0 };
+}
+
+/***********************************************************************
+ * parse_fd
+ *
+ * DESCRIPTION
+ *	Map the regular file opened as @fd and tokenize it from the current
+ *	position to the end into @pf in one pass.
+ *
+ * RETURN VALUE
+ *	Return 0 on success
+ *	Return -errno otherwise. -EINVAL if @fd is not a regular file
+ *
+ */
+static int parse_fd(int fd, struct parsed_file *pf)
+{
+	int ret;
+
+	*pf = (struct parsed_file) { 0 };
+
+	ret = __map_file(fd, pf);
+	if (ret) return ret;
+
+	ret = __index_blocks(pf, __classify ? __classify : __classify_scalar);
+	if (ret) free_parsed_file(pf);
+
+	return ret;
+}
+
+static void __print_parsed_file(const struct parsed_file *pf)
+{
+	for (size_t line = 0; line < pf->nr_lines; line++) {
+		size_t t = pf->line_start[line];
+		int nr_tokens = pf->line_start[line + 1] - t;
+
+		fprintf(stderr, "nr_tokens = %d\n", nr_tokens);
+		for (int i = 0; i < nr_tokens; i++) {
+			fprintf(stderr, "tokens[%d] = %.*s\n", i,
+					pf->token_len[t + i], pf->data + pf->token_offset[t + i]);
+		}
+		printf("\n");
+	}
+}
+
+
+int main(int argc, char *argv[])
+{
+	FILE *input = stdin;
+	struct parsed_file pf;
+	int ret;
+
+	if (argc == 2) {
+		input = fopen(argv[1], "r");
+		if (!input) {
+			fprintf(stderr, "No input file %s\n", argv[1]);
+			return -EINVAL;
+		}
+	}
+
+	ret = parse_fd(fileno(input), &pf);
+	if (ret) {
+		fprintf(stderr, "Unable to map the input: %s\n", strerror(-ret));
+	} else {
+		__print_parsed_file(&pf);
+		free_parsed_file(&pf);
+	}
+
+	if (input != stdin) fclose(input);
+
+	return ret;
+}
@@ -0,0 +1,226 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "types.h"
+#include "tokenize.h"
+
+/**
+ * Benchmark of the pa0 tokenizers.
+ *
+ * Each line of the corpus is tokenized the way pa0 tokenizes what fgets()
+ * returns, with the scalar parser and with each vectorized parser the
+ * processor supports. Every variant is run @nr_runs times and the best run
+ * is reported in the same format as pa2's parser_bench. Its quoted corpus
+ * works well here ("parser_bench -g quoted").
+ *
+ * Usage: pa0-bench {-r runs} [corpus file]
+ *  The corpus is read from stdin when no file is given.
+ */
+static int nr_runs = 5;
+
+static const struct variant {
+	const char *name;
+	void (*classify)(const char *block, struct block_class *c);
+} variants[] = {
+	{ "scalar", NULL },
+#ifdef HAVE_X86_SIMD
+	{ "sse2", __classify_sse2 },
+	{ "avx2", __classify_avx2 },
+#endif
+};
+#define NR_VARIANTS (sizeof(variants) / sizeof(*variants))
+
+static bool __supported(const struct variant *v)
+{
+#ifdef HAVE_X86_SIMD
+	if (v->classify == __classify_sse2) return !!__builtin_cpu_supports("sse2");
+	if (v->classify == __classify_avx2) return !!__builtin_cpu_supports("avx2");
+#endif
+	return true;
+}
+
+static double __now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Read all of @fd into a buffer. Return the buffer, or NULL on error */
+static char *__read_all(int fd, size_t *size)
+{
+	size_t capacity = 1 << 20;
+	char *buffer = malloc(capacity);
+	ssize_t nr_read;
+
+	*size = 0;
+	while (buffer) {
+		if (*size == capacity) {
+			char *new = realloc(buffer, capacity * 2);
+
+			if (!new) break;
+			buffer = new;
+			capacity *= 2;
+		}
+
+		nr_read = read(fd, buffer + *size, capacity - *size);
+		if (nr_read == 0) return buffer;
+		if (nr_read < 0) break;
+		*size += nr_read;
+	}
+
+	free(buffer);
+	return NULL;
+}
+
+/**
+ * Tokenize every line in @line_ptrs with @v. @lines holds each line followed
+ * by '\0' and is copied into @work before each run since the parsers modify
+ * it.
+ */
+static void __bench(const struct variant *v, const char *lines,
+		size_t lines_size, char *work, char **line_ptrs, size_t nr_lines,
+		char **tokens, size_t *nr_tokens, double *best)
+{
+	*best = 0;
+	__classify = v->classify;
+
+	for (int run = 0; run < nr_runs; run++) {
+		size_t total = 0;
+		double start;
+
+		memcpy(work, lines, lines_size);
+
+		start = __now();
+		for (size_t i = 0; i < nr_lines; i++) {
+			int nr = 0;
+
+			if (__classify) {
+				__parse_command_blocks(line_ptrs[i], &nr, tokens);
+			} else {
+				__parse_command_scalar(line_ptrs[i], &nr, tokens);
+			}
+			total += nr;
+		}
+		start = __now() - start;
+
+		if (!*best || start < *best) *best = start;
+		*nr_tokens = total;
+	}
+}
+
+int main(int argc, char * const argv[])
+{
+	void (*initial)(const char *block, struct block_class *c) = __classify;
+	const char *name = "stdin";
+	char *buffer, *lines = NULL, *work = NULL;
+	char **line_ptrs = NULL, **tokens = NULL;
+	size_t size, lines_size = 0, nr_lines = 0;
+	size_t line_len = 0, max_line_len = 0;
+	size_t expected = 0;
+	int fd = STDIN_FILENO;
+	int ret = EXIT_FAILURE;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "r:")) != -1) {
+		switch (opt) {
+		case 'r':
+			nr_runs = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s {-r runs} [corpus file]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (nr_runs <= 0) nr_runs = 1;
+
+	if (argv[optind]) {
+		fd = open(argv[optind], O_RDONLY);
+		if (fd < 0) {
+			fprintf(stderr, "No input file %s\n", argv[optind]);
+			return EXIT_FAILURE;
+		}
+		name = strrchr(argv[optind], '/') ? strrchr(argv[optind], '/') + 1 : argv[optind];
+	}
+
+	buffer = __read_all(fd, &size);
+	if (fd != STDIN_FILENO) close(fd);
+	if (!buffer) return EXIT_FAILURE;
+
+	/* Split the corpus into NUL-terminated lines as fgets() returns them */
+	lines = malloc(size * 2 + 1);
+	work = malloc(size * 2 + 1);
+	line_ptrs = malloc(sizeof(*line_ptrs) * (size + 1));
+	if (!lines || !work || !line_ptrs) goto out;
+
+	for (size_t i = 0; i < size; i++) {
+		if (i == 0 || buffer[i - 1] == '\n') {
+			line_ptrs[nr_lines++] = work + lines_size;
+			line_len = 0;
+		}
+		lines[lines_size++] = buffer[i];
+		if (++line_len > max_line_len) max_line_len = line_len;
+		if (buffer[i] == '\n' || i == size - 1) lines[lines_size++] = '\0';
+	}
+
+	/* A token may start at every other byte */
+	tokens = malloc(sizeof(*tokens) * (max_line_len / 2 + 1));
+	if (!tokens) goto out;
+
+	printf("%zu KiB in %zu lines, best of %d runs\n",
+			size >> 10, nr_lines, nr_runs);
+	printf("%-10s %-14s %10s %12s\n", "corpus", "variant", "MB/s", "Mtokens/s");
+
+	for (int i = 0; i < NR_VARIANTS; i++) {
+		size_t nr_tokens;
+		double elapsed;
+
+		if (!__supported(variants + i)) continue;
+
+		__bench(variants + i, lines, lines_size, work, line_ptrs, nr_lines,
+				tokens, &nr_tokens, &elapsed);
+		printf("%-10.10s %-14s %10.1f %12.2f\n", name, variants[i].name,
+				size / elapsed / 1e6, nr_tokens / elapsed / 1e6);
+
+		if (i == 0) expected = nr_tokens;
+		if (nr_tokens != expected) {
+			fprintf(stderr, "%s: %zu tokens while expecting %zu\n",
+					variants[i].name, nr_tokens, expected);
+			goto out;
+		}
+	}
+	ret = EXIT_SUCCESS;
+
+out:
+	__classify = initial;
+	free(tokens);
+	free(line_ptrs);
+	free(work);
+	free(lines);
+	free(buffer);
+
+	return ret;
+}
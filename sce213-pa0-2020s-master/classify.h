@@ -0,0 +1,119 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __CLASSIFY_H__
+#define __CLASSIFY_H__
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD
+#endif
+
+/**
+ * The vectorized parsers classify their input in blocks of BLOCK_SIZE bytes.
+ * Bit i of each mask corresponds to the i-th byte of the block. Blocks are
+ * loaded with aligned loads, so @block must be BLOCK_SIZE-aligned.
+ *
+ * __classify is set to the fastest classifier the processor supports, or is
+ * left NULL if there is none.
+ */
+#define BLOCK_SIZE	64
+
+struct block_class {
+	uint64_t space;	/* isspace() characters */
+	uint64_t quote;	/* '"' */
+	uint64_t newline; /* '\n' */
+	uint64_t nul;	/* The terminating '\0' */
+};
+
+static void (*__classify)(const char *block, struct block_class *c) = NULL;
+
+#ifdef HAVE_X86_SIMD
+/**
+ * isspace() in the C locale is true for ' ' and '\t' ... '\r'. The latter is
+ * tested with a single signed comparison by biasing '\t' to -128.
+ */
+#define CTRL_SPACE_BIAS		(0x80 - '\t')
+#define CTRL_SPACE_LIMIT	(-128 + ('\r' - '\t') + 1)
+
+static void __classify_sse2(const char *block, struct block_class *c)
+{
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i bias = _mm_set1_epi8(CTRL_SPACE_BIAS);
+	const __m128i limit = _mm_set1_epi8(CTRL_SPACE_LIMIT);
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i newline = _mm_set1_epi8('\n');
+	const __m128i zero = _mm_setzero_si128();
+
+	c->space = c->quote = c->newline = c->nul = 0;
+
+	for (int i = 0; i < BLOCK_SIZE; i += 16) {
+		__m128i v = _mm_load_si128((const __m128i *)(block + i));
+		__m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, space),
+				_mm_cmplt_epi8(_mm_add_epi8(v, bias), limit));
+
+		c->space |= (uint64_t)(uint16_t)_mm_movemask_epi8(ws) << i;
+		c->quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+				_mm_cmpeq_epi8(v, quote)) << i;
+		c->newline |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+				_mm_cmpeq_epi8(v, newline)) << i;
+		c->nul |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+				_mm_cmpeq_epi8(v, zero)) << i;
+	}
+}
+
+__attribute__((target("avx2")))
+static void __classify_avx2(const char *block, struct block_class *c)
+{
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i bias = _mm256_set1_epi8(CTRL_SPACE_BIAS);
+	const __m256i limit = _mm256_set1_epi8(CTRL_SPACE_LIMIT);
+	const __m256i quote = _mm256_set1_epi8('"');
+	const __m256i newline = _mm256_set1_epi8('\n');
+	const __m256i zero = _mm256_setzero_si256();
+
+	c->space = c->quote = c->newline = c->nul = 0;
+
+	for (int i = 0; i < BLOCK_SIZE; i += 32) {
+		__m256i v = _mm256_load_si256((const __m256i *)(block + i));
+		__m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+				_mm256_cmpgt_epi8(limit, _mm256_add_epi8(v, bias)));
+
+		c->space |= (uint64_t)(uint32_t)_mm256_movemask_epi8(ws) << i;
+		c->quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+				_mm256_cmpeq_epi8(v, quote)) << i;
+		c->newline |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+				_mm256_cmpeq_epi8(v, newline)) << i;
+		c->nul |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+				_mm256_cmpeq_epi8(v, zero)) << i;
+	}
+}
+
+__attribute__((constructor))
+static void __select_classifier(void)
+{
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		__classify = __classify_avx2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		__classify = __classify_sse2;
+	}
+}
+#endif
+
+#endif
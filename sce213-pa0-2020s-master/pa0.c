@@ -17,13 +17,17 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <ctype.h>
+#include <stdint.h>
 
 #include "types.h"
+#include "tokenize.h"
 
-#define MAX_NR_TOKENS 32	/* Maximum number of tokens in a command */
 #define MAX_TOKEN_LEN 64	/* Maximum length of single token */
 #define MAX_COMMAND	256		/* Maximum length of command string */
 
+/* Maximum number of tokens in a command. A token may start at every other byte */
+#define MAX_NR_TOKENS	(MAX_COMMAND / 2 + 1)
+
 /***********************************************************************
  * parse_command
  *
@@ -78,70 +82,23 @@
  *	                                             a, command
  *   "This " is "what I told you" --> This, is, what I told you
  *
+ * Quoted tokens are cut in place; @tokens[] points right after the opening
+ * quote and the closing quote is overwritten with '\0'. A quote that is not
+ * closed extends to the end of the line.
+ *
+ * @tokens[] should have room for MAX_NR_TOKENS tokens, which is as many as a
+ * command of MAX_COMMAND bytes can have.
+ *
  * RETURN VALUE
  *	Return 0 after filling in @nr_tokens and @tokens[] properly
  *
  */
 static int parse_command(char *command, int *nr_tokens, char *tokens[])
 {
-	/**
-	 * TODO
-	 *
-	 * Followings are some example code. Delete them and implement your own
-	 * code here
-		tokens[0] = "hello";
-		tokens[1] = "world";
-		*nr_tokens = 2;
-	 */
-
-	char* ptr = command;
-	char buffer[MAX_TOKEN_LEN][MAX_TOKEN_LEN] = { 0, };
-
-	int check = 1;
-	int j = 0; // buffer의 행에 해당하는 인자
-
-	while (*ptr != '\0')
-	{
-		if (isspace(*ptr)) // 문자가 공백인 경우
-		{
-			*ptr = '\0';	// 해당 칸은 NULL로 만든다.
-			check = 1;
-		}
-		else
-		{
-			if (check == 1)
-			{
-				
-				if (*ptr == '"') // 문자가 "인 경우
-				{
-					int i = 0; // buffer의 열에 해당하는 인자
-					ptr += 1;
-					//buffer[0][0] = *ptr;
-
-					while (*ptr != '"') // 다음 "를 만날 때 까지
-					{
-						buffer[j][i] = *ptr; // buffer에 *ptr값을 넣어준다.
-						i++;
-						ptr++;
-					}
-
-					tokens[*nr_tokens] = buffer[j];
-					*nr_tokens += 1;
-					j++;
-				}
-
-				else
-				{
-					check = 0;
-					tokens[*nr_tokens] = ptr;
-					*nr_tokens += 1;
-				}
-			}
-		}
-
-		ptr++;
+	if (__classify) {
+		return __parse_command_blocks(command, nr_tokens, tokens);
 	}
-	return 0;
+	return __parse_command_scalar(command, nr_tokens, tokens);
 }
 
 
@@ -0,0 +1,148 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __TOKENIZE_H__
+#define __TOKENIZE_H__
+
+#include <ctype.h>
+#include <stdint.h>
+
+#include "classify.h"
+
+/**
+ * The tokenizers behind parse_command() of pa0.c. They are kept here so that
+ * pa0-bench measures exactly what pa0 runs.
+ */
+
+/***********************************************************************
+ * Scalar parser. Used when the processor has no usable vector unit.
+ */
+static int __parse_command_scalar(char *command, int *nr_tokens, char *tokens[])
+{
+	char* ptr = command;
+	int check = 1;
+
+	while (*ptr != '\0')
+	{
+		if (isspace(*ptr)) // 문자가 공백인 경우
+		{
+			*ptr = '\0';	// 해당 칸은 NULL로 만든다.
+			check = 1;
+		}
+		else
+		{
+			if (check == 1)
+			{
+				
+				if (*ptr == '"') // 문자가 "인 경우
+				{
+					ptr += 1;
+					tokens[*nr_tokens] = ptr; // 여는 " 다음부터 token
+					*nr_tokens += 1;
+
+					// 다음 "를 만날 때 까지. 닫히지 않은 "는 줄 끝까지
+					while (*ptr != '"' && *ptr != '\n' && *ptr != '\0')
+					{
+						ptr++;
+					}
+
+					if (*ptr == '\0') break;
+					*ptr = '\0'; // 닫는 "를 NULL로 만든다.
+				}
+
+				else
+				{
+					check = 0;
+					tokens[*nr_tokens] = ptr;
+					*nr_tokens += 1;
+				}
+			}
+		}
+
+		ptr++;
+	}
+	return 0;
+}
+
+
+/***********************************************************************
+ * Vectorized parser
+ *
+ * The command is walked in BLOCK_SIZE-aligned blocks so that no load crosses
+ * a page boundary; bytes before @command and after the terminating '\0' are
+ * loaded but masked out. Instead of testing every byte, the parser jumps
+ * straight to the next byte that can change its state: a non-space byte
+ * outside of tokens, a space or '\0' in a token, and a '"', '\n', or '\0' in
+ * a quoted token.
+ */
+static int __parse_command_blocks(char *command, int *nr_tokens, char *tokens[])
+{
+	unsigned int offset = (uintptr_t)command % BLOCK_SIZE;
+	char *block = command - offset;
+	uint64_t valid = ~0ULL << offset;
+	enum { OUTSIDE, IN_TOKEN, IN_QUOTE } state = OUTSIDE;
+
+	for (;; block += BLOCK_SIZE, valid = ~0ULL) {
+		struct block_class c;
+		uint64_t word, pending;
+
+		__classify(block, &c);
+
+		/* Drop everything from the terminating '\0' */
+		c.nul &= valid;
+		c.nul &= -c.nul;
+		if (c.nul) valid &= c.nul - 1;
+
+		word = ~c.space & valid;
+		pending = valid | c.nul;	/* Bytes not visited yet */
+
+		while (true) {
+			uint64_t next;
+			int i;
+
+			if (state == OUTSIDE) {
+				next = word & pending;
+			} else if (state == IN_TOKEN) {
+				next = ~word & pending;
+			} else {
+				next = (c.quote | c.newline | c.nul) & pending;
+			}
+			if (!next) break;
+
+			i = __builtin_ctzll(next);
+			pending &= (~0ULL << i) << 1;
+
+			if (state == OUTSIDE) {
+				if (block[i] == '"') {
+					tokens[*nr_tokens] = block + i + 1;
+					state = IN_QUOTE;
+				} else {
+					tokens[*nr_tokens] = block + i;
+					state = IN_TOKEN;
+				}
+				*nr_tokens += 1;
+			} else {
+				block[i] = '\0';
+				state = OUTSIDE;
+			}
+		}
+
+		if (c.nul) break;
+	}
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,194 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include "types.h"
+#include "dircache.h"
+
+static int __cwd_fd = -1;	/* The current directory */
+
+static int *__stack = NULL;	/* Directory stack of pushd */
+static int __nr_stack = 0;
+static int __stack_capacity = 0;
+
+/* Make the open directory @fd current */
+static int __enter(int fd)
+{
+	if (fchdir(fd)) return -errno;
+
+	if (dup3(fd, __cwd_fd, O_CLOEXEC) < 0) return -errno;
+
+	return 0;
+}
+
+int init_dircache(void)
+{
+	__cwd_fd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+	if (__cwd_fd < 0) return -errno;
+
+	return 0;
+}
+
+void fini_dircache(void)
+{
+	while (__nr_stack) close(__stack[--__nr_stack]);
+	free(__stack);
+	__stack = NULL;
+	__stack_capacity = 0;
+
+	if (__cwd_fd >= 0) close(__cwd_fd);
+	__cwd_fd = -1;
+}
+
+int change_directory(const char *path)
+{
+	char home[PATH_MAX];
+	int fd;
+	int ret;
+
+	if (!path || strcmp(path, "~") == 0 || strncmp(path, "~/", 2) == 0) {
+		const char *dir = getenv("HOME");
+
+		if (!dir) return -ENOENT;
+
+		snprintf(home, sizeof(home), "%s%s", dir, path ? path + 1 : "");
+		path = home;
+	}
+
+	/* Not initialized. Fall back to the plain one */
+	if (__cwd_fd < 0) return chdir(path) ? -errno : 0;
+
+	fd = openat(__cwd_fd, path, O_PATH | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0) return -errno;
+
+	ret = __enter(fd);
+	close(fd);
+
+	return ret;
+}
+
+int run_cd(int nr_tokens, char * const tokens[])
+{
+	int ret = change_directory(nr_tokens > 1 ? tokens[1] : NULL);
+
+	if (ret) {
+		fprintf(stderr, "cd: %s: %s\n",
+				nr_tokens > 1 ? tokens[1] : "~", strerror(-ret));
+	}
+	return 1;
+}
+
+int run_pushd(int nr_tokens, char * const tokens[])
+{
+	int fd;
+	int ret;
+
+	if (__cwd_fd < 0) return -EINVAL;
+
+	if (__nr_stack == __stack_capacity) {
+		int capacity = __stack_capacity ? __stack_capacity * 2 : 8;
+		int *stack = realloc(__stack, sizeof(*stack) * capacity);
+
+		if (!stack) return -ENOMEM;
+		__stack = stack;
+		__stack_capacity = capacity;
+	}
+
+	fd = fcntl(__cwd_fd, F_DUPFD_CLOEXEC, 0);
+	if (fd < 0) return -errno;
+
+	if (nr_tokens < 2) {
+		/* Swap the current directory with the top */
+		if (!__nr_stack) {
+			fprintf(stderr, "pushd: no other directory\n");
+			close(fd);
+			return 1;
+		}
+		ret = __enter(__stack[__nr_stack - 1]);
+		if (ret) {
+			fprintf(stderr, "pushd: %s\n", strerror(-ret));
+			close(fd);
+			return 1;
+		}
+		close(__stack[__nr_stack - 1]);
+		__stack[__nr_stack - 1] = fd;
+		return 1;
+	}
+
+	ret = change_directory(tokens[1]);
+	if (ret) {
+		fprintf(stderr, "pushd: %s: %s\n", tokens[1], strerror(-ret));
+		close(fd);
+		return 1;
+	}
+	__stack[__nr_stack++] = fd;
+
+	return 1;
+}
+
+int run_popd(int nr_tokens, char * const tokens[])
+{
+	int ret;
+
+	if (!__nr_stack) {
+		fprintf(stderr, "popd: directory stack empty\n");
+		return 1;
+	}
+
+	ret = __enter(__stack[__nr_stack - 1]);
+	if (ret) {
+		fprintf(stderr, "popd: %s\n", strerror(-ret));
+		return 1;
+	}
+	close(__stack[--__nr_stack]);
+
+	return 1;
+}
+
+/* Print the path of the open directory @fd */
+static void __print_dir(int fd, char sep)
+{
+	char proc[64], path[PATH_MAX];
+	ssize_t len;
+
+	snprintf(proc, sizeof(proc), "/proc/self/fd/%d", fd);
+	len = readlink(proc, path, sizeof(path) - 1);
+	if (len < 0) len = snprintf(path, sizeof(path), "?");
+	path[len] = '\0';
+
+	printf("%s%c", path, sep);
+}
+
+int run_dirs(int nr_tokens, char * const tokens[])
+{
+	if (__cwd_fd < 0) return 1;
+
+	__print_dir(__cwd_fd, __nr_stack ? ' ' : '\n');
+	for (int i = __nr_stack - 1; i >= 0; i--) {
+		__print_dir(__stack[i], i ? ' ' : '\n');
+	}
+
+	/* Commands launched next write to stdout as well */
+	fflush(stdout);
+	return 1;
+}
@@ -0,0 +1,75 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __DIRCACHE_H__
+#define __DIRCACHE_H__
+
+/**
+ * The shell keeps the current directory open. cd resolves a path relative to
+ * the open directory with openat(), so a relative path is not looked up from
+ * the root again, and switches to it with fchdir(). The directory stack of
+ * pushd and popd holds open directories as well, so popd goes back to the
+ * very directory even if its path leads elsewhere now.
+ */
+
+/***********************************************************************
+ * init_dircache()
+ * fini_dircache()
+ *
+ * RETURN VALUE
+ *  init_dircache() returns 0 on success, -errno otherwise
+ *
+ */
+int init_dircache(void);
+void fini_dircache(void);
+
+/***********************************************************************
+ * change_directory()
+ *
+ * DESCRIPTION
+ *  Change the current directory to @path. NULL and "~" stand for $HOME, and
+ *  "~/" at the beginning of @path for the path of $HOME.
+ *
+ * RETURN VALUE
+ *  Return 0 on success, -errno otherwise
+ *
+ */
+int change_directory(const char *path);
+
+/***********************************************************************
+ * run_cd()
+ * run_pushd()
+ * run_popd()
+ * run_dirs()
+ *
+ * DESCRIPTION
+ *  The directory built-in commands:
+ *   cd [dir]       : Change the current directory
+ *   pushd [dir]    : Save the current directory on the stack and change to
+ *                    @dir, or swap with the top of the stack without @dir
+ *   popd           : Change to the directory on the top of the stack
+ *   dirs           : List the current directory and the stack
+ *
+ * RETURN VALUE
+ *  Return 1 as run_command() does
+ *
+ */
+int run_cd(int nr_tokens, char * const tokens[]);
+int run_pushd(int nr_tokens, char * const tokens[]);
+int run_popd(int nr_tokens, char * const tokens[]);
+int run_dirs(int nr_tokens, char * const tokens[]);
+
+#endif
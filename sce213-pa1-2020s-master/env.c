@@ -0,0 +1,309 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <ctype.h>
+
+#include "types.h"
+#include "pathcache.h"
+#include "env.h"
+
+extern char **environ;
+
+struct variable {
+	struct variable *next;
+	char *value;
+	size_t len;		/* Length of @name */
+	char name[];
+};
+
+static struct variable *__buckets[NR_ENV_BUCKETS] = { NULL };
+static int __nr_variables = 0;
+
+/* Expanded tokens handed out by the last expand_tokens() */
+static char **__expanded = NULL;
+static int __nr_expanded = 0;
+static char **__argv = NULL;
+
+/* FNV-1a */
+static unsigned int __hash(const char *name, size_t len)
+{
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < len; i++) {
+		hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+	}
+	return hash & (NR_ENV_BUCKETS - 1);
+}
+
+static struct variable **__find(const char *name, size_t len)
+{
+	struct variable **pv = &__buckets[__hash(name, len)];
+
+	for (; *pv; pv = &(*pv)->next) {
+		if ((*pv)->len == len && memcmp((*pv)->name, name, len) == 0) break;
+	}
+	return pv;
+}
+
+/* Set @name of @len bytes to @value in the table */
+static int __set(const char *name, size_t len, const char *value)
+{
+	struct variable **pv = __find(name, len);
+	char *copy = strdup(value);
+
+	if (!copy) return -ENOMEM;
+
+	if (!*pv) {
+		struct variable *v = malloc(sizeof(*v) + len + 1);
+
+		if (!v) {
+			free(copy);
+			return -ENOMEM;
+		}
+		memcpy(v->name, name, len);
+		v->name[len] = '\0';
+		v->len = len;
+		v->value = NULL;
+		v->next = NULL;
+
+		*pv = v;
+		__nr_variables++;
+	}
+
+	free((*pv)->value);
+	(*pv)->value = copy;
+
+	return 0;
+}
+
+static void __unset(const char *name, size_t len)
+{
+	struct variable **pv = __find(name, len);
+	struct variable *v = *pv;
+
+	if (!v) return;
+
+	*pv = v->next;
+	free(v->value);
+	free(v);
+	__nr_variables--;
+}
+
+int init_env(void)
+{
+	for (char **env = environ; *env; env++) {
+		const char *equal = strchr(*env, '=');
+		int ret;
+
+		if (!equal) continue;
+		if ((ret = __set(*env, equal - *env, equal + 1))) return ret;
+	}
+	return 0;
+}
+
+static void __release_expanded(void)
+{
+	while (__nr_expanded) free(__expanded[--__nr_expanded]);
+	free(__expanded);
+	free(__argv);
+	__expanded = NULL;
+	__argv = NULL;
+}
+
+void fini_env(void)
+{
+	__release_expanded();
+
+	for (int i = 0; i < NR_ENV_BUCKETS; i++) {
+		while (__buckets[i]) __unset(__buckets[i]->name, __buckets[i]->len);
+	}
+}
+
+const char *lookup_variable(const char *name, size_t len)
+{
+	struct variable *v = *__find(name, len);
+
+	return v ? v->value : NULL;
+}
+
+static bool __is_name(int c, bool first)
+{
+	return c == '_' || isalpha(c) || (!first && isdigit(c));
+}
+
+/**
+ * Expand @token into a new string. A '$' not followed by a name, or an
+ * unterminated "${", is left as it is.
+ */
+static char *__expand(const char *token)
+{
+	size_t capacity = strlen(token) + 1, len = 0;
+	char *expanded = malloc(capacity);
+	const char *p = token;
+
+	if (!expanded) return NULL;
+
+	while (*p) {
+		const char *name = p + 1, *end, *value = NULL;
+		size_t value_len;
+
+		if (*p == '$' && *name == '{' && (end = strchr(name, '}')) &&
+				end > name + 1) {
+			value = lookup_variable(name + 1, end - name - 1);
+			p = end + 1;
+		} else if (*p == '$' && __is_name(*name, true)) {
+			for (end = name; __is_name(*end, false); end++);
+			value = lookup_variable(name, end - name);
+			p = end;
+		} else {
+			value = p++;
+			value_len = 1;
+			goto append;
+		}
+		if (!value) continue;
+		value_len = strlen(value);
+
+append:
+		if (len + value_len + 1 > capacity) {
+			char *grown;
+
+			capacity = (len + value_len + 1) * 2;
+			if (!(grown = realloc(expanded, capacity))) {
+				free(expanded);
+				return NULL;
+			}
+			expanded = grown;
+		}
+		memcpy(expanded + len, value, value_len);
+		len += value_len;
+	}
+	expanded[len] = '\0';
+
+	return expanded;
+}
+
+char **expand_tokens(int *nr_tokens, char *tokens[])
+{
+	int i, nr = 0;
+
+	for (i = 0; i < *nr_tokens; i++) {
+		if (strchr(tokens[i], '$')) break;
+	}
+	if (i == *nr_tokens) return tokens;
+
+	__release_expanded();
+
+	__argv = malloc(sizeof(*__argv) * (*nr_tokens + 1));
+	__expanded = malloc(sizeof(*__expanded) * *nr_tokens);
+	if (!__argv || !__expanded) {
+		__release_expanded();
+		return NULL;
+	}
+
+	for (i = 0; i < *nr_tokens; i++) {
+		char *token = tokens[i];
+
+		if (strchr(token, '$')) {
+			if (!(token = __expand(token))) {
+				__release_expanded();
+				return NULL;
+			}
+			__expanded[__nr_expanded++] = token;
+
+			if (!*token) continue;
+		}
+		__argv[nr++] = token;
+	}
+	__argv[nr] = NULL;
+	*nr_tokens = nr;
+
+	return __argv;
+}
+
+static int __compare_names(const void *a, const void *b)
+{
+	return strcmp((*(struct variable * const *)a)->name,
+			(*(struct variable * const *)b)->name);
+}
+
+int run_export(int nr_tokens, char * const tokens[])
+{
+	if (nr_tokens == 1) {
+		struct variable **sorted = malloc(sizeof(*sorted) * __nr_variables);
+		int nr = 0;
+
+		if (!sorted) return -ENOMEM;
+
+		for (int i = 0; i < NR_ENV_BUCKETS; i++) {
+			for (struct variable *v = __buckets[i]; v; v = v->next) {
+				sorted[nr++] = v;
+			}
+		}
+		qsort(sorted, nr, sizeof(*sorted), __compare_names);
+
+		for (int i = 0; i < nr; i++) {
+			printf("export %s=%s\n", sorted[i]->name, sorted[i]->value);
+		}
+		free(sorted);
+		return 1;
+	}
+
+	for (int i = 1; i < nr_tokens; i++) {
+		char *equal = strchr(tokens[i], '=');
+		size_t len = equal ? equal - tokens[i] : strlen(tokens[i]);
+		bool valid = len && __is_name(tokens[i][0], true);
+		int ret;
+
+		for (size_t j = 1; valid && j < len; j++) {
+			valid = __is_name(tokens[i][j], false);
+		}
+		if (!valid) {
+			fprintf(stderr, "export: %s: not a valid identifier\n", tokens[i]);
+			continue;
+		}
+		/* Every variable is in the environment already */
+		if (!equal) continue;
+
+		/* Keep environ in sync for the commands and getenv() */
+		*equal = '\0';
+		ret = setenv(tokens[i], equal + 1, 1);
+		if (!ret) ret = __set(tokens[i], len, equal + 1);
+		if (!ret && strcmp(tokens[i], "PATH") == 0) clear_path_cache();
+		*equal = '=';
+
+		if (ret) fprintf(stderr, "export: %s\n", strerror(ret < 0 ? -ret : errno));
+	}
+	return 1;
+}
+
+int run_unset(int nr_tokens, char * const tokens[])
+{
+	for (int i = 1; i < nr_tokens; i++) {
+		if (unsetenv(tokens[i])) {
+			fprintf(stderr, "unset: %s: %s\n", tokens[i], strerror(errno));
+			continue;
+		}
+		__unset(tokens[i], strlen(tokens[i]));
+
+		if (strcmp(tokens[i], "PATH") == 0) clear_path_cache();
+	}
+	return 1;
+}
@@ -0,0 +1,82 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __ENV_H__
+#define __ENV_H__
+
+/**
+ * The shell keeps a copy of the environment in a hash table so that $VAR in
+ * command lines is expanded with a single lookup. export and unset update
+ * the table and the environment passed to commands together.
+ */
+#define NR_ENV_BUCKETS	256	/* Must be a power of 2 */
+
+/***********************************************************************
+ * init_env()
+ * fini_env()
+ *
+ * RETURN VALUE
+ *  init_env() returns 0 on success, -errno otherwise
+ *
+ */
+int init_env(void);
+void fini_env(void);
+
+/***********************************************************************
+ * lookup_variable()
+ *
+ * RETURN VALUE
+ *  Return the value of the variable named by the first @len bytes of @name,
+ *  or NULL if it is not set
+ *
+ */
+const char *lookup_variable(const char *name, size_t len);
+
+/***********************************************************************
+ * expand_tokens()
+ *
+ * DESCRIPTION
+ *  Expand $NAME and ${NAME} in @tokens with the values of the variables.
+ *  Unset variables expand to nothing, and tokens that become empty are
+ *  dropped from @nr_tokens. Tokens without '$' are not touched, and @tokens
+ *  is returned as it is when none of them has '$'. Otherwise the expanded
+ *  tokens are put in a new NULL-terminated array that stays valid until the
+ *  next call.
+ *
+ * RETURN VALUE
+ *  Return the tokens, or NULL if out of memory
+ *
+ */
+char **expand_tokens(int *nr_tokens, char *tokens[]);
+
+/***********************************************************************
+ * run_export()
+ * run_unset()
+ *
+ * DESCRIPTION
+ *  The variable built-in commands:
+ *   export                     : List the variables
+ *   export NAME=VALUE ...      : Set the variables
+ *   unset NAME ...             : Remove the variables
+ *
+ * RETURN VALUE
+ *  Return 1 as run_command() does
+ *
+ */
+int run_export(int nr_tokens, char * const tokens[]);
+int run_unset(int nr_tokens, char * const tokens[]);
+
+#endif
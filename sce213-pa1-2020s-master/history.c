@@ -0,0 +1,246 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "types.h"
+#include "history.h"
+
+#define HISTORY_MAGIC	"myshhist"
+
+struct history_header {
+	char magic[8];
+	uint64_t size;		/* Bytes of the lines following the header */
+	uint64_t nr_lines;
+	uint64_t __reserved;
+};
+
+static struct history_header *__history = NULL;
+static size_t __capacity = 0;	/* Size of the mapping */
+static int __fd = -1;		/* -1 if the history is in memory only */
+
+static char *__log(void)
+{
+	return (char *)(__history + 1);
+}
+
+static size_t __round_up(size_t size)
+{
+	return (size + HISTORY_CHUNK - 1) / HISTORY_CHUNK * HISTORY_CHUNK;
+}
+
+/* Keep the history in an anonymous mapping */
+static int __map_memory(void)
+{
+	__capacity = HISTORY_CHUNK;
+	__history = mmap(NULL, __capacity, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (__history == MAP_FAILED) {
+		__history = NULL;
+		return -errno;
+	}
+	memcpy(__history->magic, HISTORY_MAGIC, sizeof(__history->magic));
+
+	return 0;
+}
+
+/* Map the history file @fd, which is locked for us */
+static int __map_file(int fd)
+{
+	struct history_header header;
+	struct stat st;
+
+	if (fstat(fd, &st)) return -errno;
+
+	if (st.st_size) {
+		if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+				memcmp(header.magic, HISTORY_MAGIC, sizeof(header.magic)) ||
+				sizeof(header) + header.size > st.st_size) {
+			return -EINVAL;
+		}
+	}
+
+	/* Leave room to append. The file is cut back in fini_history() */
+	__capacity = __round_up(st.st_size + 1);
+	if (ftruncate(fd, __capacity)) return -errno;
+
+	__history = mmap(NULL, __capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (__history == MAP_FAILED) {
+		__history = NULL;
+		return -errno;
+	}
+	if (!st.st_size) {
+		memcpy(__history->magic, HISTORY_MAGIC, sizeof(__history->magic));
+	}
+	__fd = fd;
+
+	return 0;
+}
+
+int init_history(void)
+{
+	const char *path = getenv("MYSH_HISTORY");
+	const char *home = getenv("HOME");
+	char buffer[4096];
+	int fd;
+
+	/* Commands piped or redirected in are not worth remembering */
+	if (!path && !isatty(STDIN_FILENO)) return 0;
+
+	if (!path && home) {
+		snprintf(buffer, sizeof(buffer), "%s/%s", home, HISTORY_FILE);
+		path = buffer;
+	}
+	if (!path) return __map_memory();
+
+	fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (fd < 0) return __map_memory();
+
+	if (flock(fd, LOCK_EX | LOCK_NB) || __map_file(fd)) {
+		close(fd);
+		return __map_memory();
+	}
+	return 0;
+}
+
+void fini_history(void)
+{
+	if (!__history) return;
+
+	if (__fd >= 0) {
+		off_t size = sizeof(*__history) + __history->size;
+
+		munmap(__history, __capacity);
+		if (ftruncate(__fd, size)) perror("history");
+		close(__fd);
+		__fd = -1;
+	} else {
+		munmap(__history, __capacity);
+	}
+	__history = NULL;
+}
+
+/* Make room for @size more bytes of the log */
+static int __reserve(size_t size)
+{
+	size_t needed = sizeof(*__history) + __history->size + size;
+	size_t capacity = __capacity;
+	void *history;
+
+	if (needed <= __capacity) return 0;
+
+	while (capacity < needed) capacity *= 2;
+	capacity = __round_up(capacity);
+
+	if (__fd >= 0 && ftruncate(__fd, capacity)) return -errno;
+
+	history = mremap(__history, __capacity, capacity, MREMAP_MAYMOVE);
+	if (history == MAP_FAILED) return -errno;
+
+	__history = history;
+	__capacity = capacity;
+
+	return 0;
+}
+
+void record_history(int nr_tokens, char * const tokens[])
+{
+	uint32_t len = 0;
+	char *p;
+
+	if (!__history || nr_tokens == 0) return;
+
+	for (int i = 0; i < nr_tokens; i++) {
+		len += strlen(tokens[i]) + (i > 0);
+	}
+	if (__reserve(sizeof(len) * 2 + len)) return;
+
+	p = __log() + __history->size;
+	memcpy(p, &len, sizeof(len));
+	p += sizeof(len);
+
+	for (int i = 0; i < nr_tokens; i++) {
+		size_t n = strlen(tokens[i]);
+
+		if (i > 0) *p++ = ' ';
+		memcpy(p, tokens[i], n);
+		p += n;
+	}
+	memcpy(p, &len, sizeof(len));
+
+	/* Publish the line after it is written out */
+	__history->size += sizeof(len) * 2 + len;
+	__history->nr_lines++;
+}
+
+int run_history(int nr_tokens, char * const tokens[])
+{
+	uint64_t nr_lines, offset, number, i;
+	char *log;
+
+	if (!__history) return 1;
+
+	nr_lines = __history->nr_lines;
+	offset = __history->size;
+	log = __log();
+
+	if (nr_tokens > 1) {
+		long n = atol(tokens[1]);
+
+		if (n < 0) {
+			fprintf(stderr, "history: %s: invalid number\n", tokens[1]);
+			return 1;
+		}
+		if (n < nr_lines) nr_lines = n;
+	}
+
+	/**
+	 * Walk back over the last @nr_lines lines through the trailing lengths.
+	 * The file may have been written by anyone, so stop at a length that
+	 * does not fit in what is left of the log.
+	 */
+	for (i = 0; i < nr_lines; i++) {
+		uint32_t len;
+
+		if (offset < sizeof(len) * 2) break;
+		memcpy(&len, log + offset - sizeof(len), sizeof(len));
+		if (len > offset - sizeof(len) * 2) break;
+		offset -= sizeof(len) * 2 + len;
+	}
+
+	number = __history->nr_lines >= i ? __history->nr_lines - i + 1 : 1;
+	for (; offset < __history->size; number++) {
+		uint32_t len;
+
+		if (__history->size - offset < sizeof(len) * 2) break;
+		memcpy(&len, log + offset, sizeof(len));
+		if (len > __history->size - offset - sizeof(len) * 2) break;
+
+		printf("%5lu  %.*s\n", (unsigned long)number, (int)len,
+				log + offset + sizeof(len));
+		offset += sizeof(len) * 2 + len;
+	}
+	return 1;
+}
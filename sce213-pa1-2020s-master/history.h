@@ -0,0 +1,72 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __HISTORY_H__
+#define __HISTORY_H__
+
+/**
+ * The command lines typed into the shell are kept in a history file, which is
+ * $MYSH_HISTORY or ~/.mysh_history. Without $MYSH_HISTORY, no history is kept
+ * unless the standard input is a terminal, so scripts and tests piped into the
+ * shell leave ~/.mysh_history alone. The file is mapped into memory and lines
+ * are appended to the mapping, so recording a line takes no system call
+ * unless the file has to grow.
+ *
+ * The file starts with a header holding the size of the log and the number of
+ * lines in it. Each line follows as its length, the line, and its length
+ * again, so the log can be walked back from the end as well. The file is grown
+ * in HISTORY_CHUNK steps and cut to the real size of the log on exit.
+ *
+ * Another shell holding the file, or a file that is not a history file, makes
+ * the history of this shell kept in memory only.
+ */
+#define HISTORY_FILE	".mysh_history"
+#define HISTORY_CHUNK	(64 << 10)
+
+/***********************************************************************
+ * init_history()
+ * fini_history()
+ *
+ * RETURN VALUE
+ *  init_history() returns 0 on success, -errno otherwise
+ *
+ */
+int init_history(void);
+void fini_history(void);
+
+/***********************************************************************
+ * record_history()
+ *
+ * DESCRIPTION
+ *  Append the command line of @tokens to the history
+ *
+ */
+void record_history(int nr_tokens, char * const tokens[]);
+
+/***********************************************************************
+ * run_history()
+ *
+ * DESCRIPTION
+ *  The history built-in command:
+ *   history [N]    : List the last N command lines, or all of them
+ *
+ * RETURN VALUE
+ *  Return 1 as run_command() does
+ *
+ */
+int run_history(int nr_tokens, char * const tokens[]);
+
+#endif
@@ -0,0 +1,112 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "types.h"
+#include "instrument.h"
+
+/* Bucket b counts the samples in [2^(b-1), 2^b) usec; bucket 0 below 1 usec */
+#define NR_BUCKETS	32
+#define BAR_WIDTH	40
+
+static const char * const __phase_names[NR_PHASES] = {
+	[PHASE_PARSE] = "parse",
+	[PHASE_LAUNCH] = "launch",
+	[PHASE_RUN] = "run",
+	[PHASE_WAIT] = "wait",
+};
+
+static struct {
+	unsigned long buckets[NR_BUCKETS];
+	unsigned long nr_samples;
+	double total;
+	double max;
+} __phases[NR_PHASES];
+
+static bool __enabled = false;
+
+void enable_instrument(void)
+{
+	__enabled = true;
+}
+
+bool instrumenting(void)
+{
+	return __enabled;
+}
+
+double instrument_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void record_phase(enum phase phase, double from, double to)
+{
+	double elapsed = to - from;
+	unsigned long usec;
+	int b = 0;
+
+	if (!__enabled) return;
+	if (elapsed < 0) elapsed = 0;
+
+	for (usec = elapsed * 1e6; usec && b < NR_BUCKETS - 1; usec >>= 1) b++;
+
+	__phases[phase].buckets[b]++;
+	__phases[phase].nr_samples++;
+	__phases[phase].total += elapsed;
+	if (elapsed > __phases[phase].max) __phases[phase].max = elapsed;
+}
+
+void report_phases(FILE *stream)
+{
+	for (int p = 0; p < NR_PHASES; p++) {
+		unsigned long peak = 0;
+		int first = NR_BUCKETS, last = 0;
+
+		if (!__phases[p].nr_samples) continue;
+
+		for (int b = 0; b < NR_BUCKETS; b++) {
+			if (!__phases[p].buckets[b]) continue;
+
+			if (b < first) first = b;
+			last = b;
+			if (__phases[p].buckets[b] > peak) peak = __phases[p].buckets[b];
+		}
+
+		fprintf(stream, "%s: %lu samples, mean %.1f usec, max %.1f usec\n",
+				__phase_names[p], __phases[p].nr_samples,
+				__phases[p].total * 1e6 / __phases[p].nr_samples,
+				__phases[p].max * 1e6);
+
+		for (int b = first; b <= last; b++) {
+			unsigned long count = __phases[p].buckets[b];
+			char bar[BAR_WIDTH + 1];
+			int width = count * BAR_WIDTH / peak;
+
+			memset(bar, '#', width);
+			bar[width] = '\0';
+
+			fprintf(stream, "  %8lu - %8lu usec %8lu |%s\n",
+					b ? 1UL << (b - 1) : 0, 1UL << b, count, bar);
+		}
+	}
+}
@@ -0,0 +1,76 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __INSTRUMENT_H__
+#define __INSTRUMENT_H__
+
+#include <stdio.h>
+
+#include "types.h"
+
+/**
+ * Phases of running a command, from reading the command line to collecting
+ * the exit status of the command.
+ */
+enum phase {
+	PHASE_PARSE = 0,	/* Tokenizing the command line once it is read */
+	PHASE_LAUNCH,		/* Launching the command until its pid is back */
+	PHASE_RUN,		/* From the launch until the child is reaped */
+	PHASE_WAIT,		/* From the reap until the wait returns */
+	NR_PHASES,
+};
+
+/***********************************************************************
+ * enable_instrument()
+ * instrumenting()
+ *
+ * DESCRIPTION
+ *  Start recording the phases. Nothing is recorded until then.
+ *
+ */
+void enable_instrument(void);
+bool instrumenting(void);
+
+/***********************************************************************
+ * instrument_now()
+ *
+ * RETURN VALUE
+ *  Return the CLOCK_MONOTONIC time in seconds
+ *
+ */
+double instrument_now(void);
+
+/***********************************************************************
+ * record_phase()
+ *
+ * DESCRIPTION
+ *  Add the phase @phase that lasted from @from to @to to its histogram.
+ *  Ignored unless instrumenting.
+ *
+ */
+void record_phase(enum phase phase, double from, double to);
+
+/***********************************************************************
+ * report_phases()
+ *
+ * DESCRIPTION
+ *  Print the latency histogram of each phase recorded to @stream. The
+ *  buckets are powers of two in microseconds.
+ *
+ */
+void report_phases(FILE *stream);
+
+#endif
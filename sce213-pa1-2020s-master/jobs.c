@@ -0,0 +1,307 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "types.h"
+#include "keywords.h"
+#include "launch.h"
+#include "reaper.h"
+#include "redirect.h"
+#include "jobs.h"
+
+struct job {
+	int id;
+	struct child *child;
+	char *command;		/* The tokens joined with spaces */
+	struct job *next;
+};
+
+/* Jobs sorted by id. The address tells background children from others */
+static struct job *__jobs = NULL;
+
+static enum keyword __keyword(const char *token)
+{
+	return token ? keyword_lookup(token, strlen(token)) : KW_NONE;
+}
+
+static char *__join(int nr_tokens, char * const tokens[])
+{
+	size_t len = 0;
+	char *command;
+
+	for (int i = 0; i < nr_tokens; i++) {
+		len += strlen(tokens[i]) + 1;
+	}
+
+	command = malloc(len);
+	if (!command) return NULL;
+
+	command[0] = '\0';
+	for (int i = 0; i < nr_tokens; i++) {
+		if (i) strcat(command, " ");
+		strcat(command, tokens[i]);
+	}
+	return command;
+}
+
+static const char *__state(const struct job *job, char *buffer, size_t len)
+{
+	int status = job->child->status;
+
+	if (!job->child->exited) return "Running";
+
+	if (WIFSIGNALED(status)) {
+		snprintf(buffer, len, "%s", strsignal(WTERMSIG(status)));
+	} else if (WEXITSTATUS(status)) {
+		snprintf(buffer, len, "Exit %d", WEXITSTATUS(status));
+	} else {
+		return "Done";
+	}
+	return buffer;
+}
+
+static void __print(const struct job *job)
+{
+	char buffer[40];
+
+	fprintf(stderr, "[%d] %-10s %s\n", job->id,
+			__state(job, buffer, sizeof(buffer)), job->command);
+}
+
+static void __remove(struct job *job)
+{
+	struct job **pj;
+
+	for (pj = &__jobs; *pj; pj = &(*pj)->next) {
+		if (*pj == job) {
+			*pj = job->next;
+			break;
+		}
+	}
+
+	release_child(job->child);
+	free(job->command);
+	free(job);
+}
+
+static struct job *__find(const char *id)
+{
+	char *end;
+	long nr;
+
+	if (id[0] == '%') id++;
+
+	nr = strtol(id, &end, 10);
+	if (end == id || *end) return NULL;
+
+	for (struct job *job = __jobs; job; job = job->next) {
+		if (job->id == nr) return job;
+	}
+	return NULL;
+}
+
+static struct job *__latest(void)
+{
+	struct job *job = __jobs;
+
+	while (job && job->next) job = job->next;
+	return job;
+}
+
+bool is_background(int *nr_tokens, char *tokens[])
+{
+	char *last;
+	size_t len;
+
+	if (*nr_tokens == 0) return false;
+
+	last = tokens[*nr_tokens - 1];
+	if (__keyword(last) == KW_BACKGROUND) {
+		tokens[--(*nr_tokens)] = NULL;
+		return true;
+	}
+
+	/* "sleep 5&" but not "a&&" */
+	len = strlen(last);
+	if (len > 1 && last[len - 1] == '&' && last[len - 2] != '&') {
+		last[len - 1] = '\0';
+		return true;
+	}
+	return false;
+}
+
+int run_background(int nr_tokens, char *tokens[], unsigned int timeout)
+{
+	struct redirection redirections[1 + REDIRECT_MAX] = {
+		{ STDIN_FILENO, -1 },
+	};
+	struct redirections files;
+	struct job *job, **pj;
+	int id = 1;
+	pid_t pid;
+
+	if (open_redirections(&nr_tokens, tokens, &files)) return 1;
+
+	if (nr_tokens == 0) {
+		fprintf(stderr, "mysh: syntax error near &\n");
+		close_redirections(&files);
+		return 1;
+	}
+	for (int i = 0; i < nr_tokens; i++) {
+		if (__keyword(tokens[i]) == KW_NONE) continue;
+
+		fprintf(stderr, "mysh: %s cannot be run in the background\n",
+				tokens[i]);
+		close_redirections(&files);
+		return 1;
+	}
+
+	job = calloc(1, sizeof(*job));
+	if (!job || !(job->command = __join(nr_tokens, tokens))) {
+		free(job);
+		close_redirections(&files);
+		return -ENOMEM;
+	}
+
+	redirections[0].target = open("/dev/null", O_RDONLY | O_CLOEXEC);
+	if (redirections[0].target < 0) {
+		free(job->command);
+		free(job);
+		close_redirections(&files);
+		return -errno;
+	}
+
+	/* Redirections in the command come later and win over /dev/null */
+	memcpy(redirections + 1, files.r, sizeof(*files.r) * files.nr);
+	pid = launch_command_redirected(tokens, redirections, 1 + files.nr,
+			NULL, NULL);
+	close(redirections[0].target);
+	close_redirections(&files);
+
+	if (pid < 0) {
+		fprintf(stderr, "No such file or directory\n");
+		free(job->command);
+		free(job);
+		return 1;
+	}
+
+	job->child = watch_child(pid, tokens[0], timeout);
+	if (!job->child) {
+		waitpid(pid, NULL, 0);
+		free(job->command);
+		free(job);
+		return -ENOMEM;
+	}
+	job->child->owner = &__jobs;
+
+	/* Take the id next to the latest job, keeping the table sorted */
+	for (pj = &__jobs; *pj; pj = &(*pj)->next) {
+		id = (*pj)->id + 1;
+	}
+	job->id = id;
+	*pj = job;
+
+	fprintf(stderr, "[%d] %d\n", job->id, pid);
+
+	return 1;
+}
+
+void notify_jobs(void)
+{
+	struct job *job, *next;
+
+	if (!__jobs) return;
+
+	reap_children();
+
+	for (job = __jobs; job; job = next) {
+		next = job->next;
+		if (!job->child->exited) continue;
+
+		__print(job);
+		__remove(job);
+	}
+}
+
+int run_jobs(int nr_tokens, char * const tokens[])
+{
+	reap_children();
+
+	for (struct job *job = __jobs; job; job = job->next) {
+		__print(job);
+	}
+	return 1;
+}
+
+static void __wait_job(struct job *job)
+{
+	wait_child(job->child);
+	__print(job);
+	__remove(job);
+}
+
+int run_wait(int nr_tokens, char * const tokens[])
+{
+	if (nr_tokens == 1) {
+		while (__jobs) __wait_job(__jobs);
+		return 1;
+	}
+
+	for (int i = 1; i < nr_tokens; i++) {
+		struct job *job = __find(tokens[i]);
+
+		if (!job) {
+			fprintf(stderr, "wait: %s: no such job\n", tokens[i]);
+			continue;
+		}
+		__wait_job(job);
+	}
+	return 1;
+}
+
+int run_fg(int nr_tokens, char * const tokens[])
+{
+	struct job *job = nr_tokens > 1 ? __find(tokens[1]) : __latest();
+
+	if (!job) {
+		fprintf(stderr, "fg: %s: no such job\n",
+				nr_tokens > 1 ? tokens[1] : "current");
+		return 1;
+	}
+
+	fprintf(stderr, "%s\n", job->command);
+	wait_child(job->child);
+
+	/* Report abnormal endings only, as for foreground commands */
+	if (!WIFEXITED(job->child->status) || WEXITSTATUS(job->child->status))
+		__print(job);
+	__remove(job);
+
+	return 1;
+}
+
+void fini_jobs(void)
+{
+	while (__jobs) __remove(__jobs);
+}
@@ -0,0 +1,93 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __JOBS_H__
+#define __JOBS_H__
+
+/***********************************************************************
+ * is_background()
+ *
+ * DESCRIPTION
+ *  Tell whether the command ends with "&", either as a token of its own or
+ *  attached to the last token as in "sleep 5&" but not as in "a&&". If so,
+ *  the "&" is stripped from @tokens and @nr_tokens is updated accordingly.
+ *
+ * RETURN VALUE
+ *  Return true if the command should run in the background
+ *
+ */
+bool is_background(int *nr_tokens, char *tokens[]);
+
+/***********************************************************************
+ * run_background()
+ *
+ * DESCRIPTION
+ *  Launch the command in the background and add it to the job table. The
+ *  job reads from /dev/null so that it does not steal commands from the
+ *  shell, and is killed after @timeout seconds unless @timeout is 0 in the
+ *  same way as commands in the foreground. "[id] pid" is printed to stderr.
+ *
+ *  Only external commands can run in the background; built-in commands and
+ *  pipelines are refused.
+ *
+ * RETURN VALUE
+ *  Return 1 as run_command() does
+ *
+ */
+int run_background(int nr_tokens, char *tokens[], unsigned int timeout);
+
+/***********************************************************************
+ * notify_jobs()
+ *
+ * DESCRIPTION
+ *  Collect exited background jobs without blocking, report them, and drop
+ *  them from the job table. Call this before showing the prompt.
+ *
+ */
+void notify_jobs(void);
+
+/***********************************************************************
+ * run_jobs()
+ * run_wait()
+ * run_fg()
+ *
+ * DESCRIPTION
+ *  The job control built-in commands:
+ *   jobs             List the jobs in the job table
+ *   wait [id ...]    Wait for the jobs, or for all jobs if none is given
+ *   fg [id]          Bring the job, or the latest one, to the foreground
+ *
+ *  A job id may be prefixed with '%' as in "fg %2".
+ *
+ * RETURN VALUE
+ *  Return 1 as run_command() does
+ *
+ */
+int run_jobs(int nr_tokens, char * const tokens[]);
+int run_wait(int nr_tokens, char * const tokens[]);
+int run_fg(int nr_tokens, char * const tokens[]);
+
+/***********************************************************************
+ * fini_jobs()
+ *
+ * DESCRIPTION
+ *  Empty the job table. Jobs still running are left running. Call this
+ *  before fini_reaper().
+ *
+ */
+void fini_jobs(void);
+
+#endif
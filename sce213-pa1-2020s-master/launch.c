@@ -0,0 +1,311 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "types.h"
+#include "launch.h"
+#include "pathcache.h"
+#include "reaper.h"
+#include "zygote.h"
+#include "redirect.h"
+
+extern char **environ;
+
+static pid_t __launch_spawn(const char *path, char * const argv[],
+		const struct redirection *redirections, int nr_redirections)
+{
+	const sigset_t *sigmask = reaper_sigmask();
+	posix_spawnattr_t attr, *pattr = NULL;
+	posix_spawn_file_actions_t actions, *pactions = NULL;
+	pid_t pid;
+	int ret;
+
+	/**
+	 * glibc spawns with vfork semantics and reports the failure of exec
+	 * back to the parent, so nothing is left to be done in the child.
+	 * The child should not inherit SIGCHLD blocked for the reaper though.
+	 */
+	if (sigmask) {
+		posix_spawnattr_init(&attr);
+		posix_spawnattr_setsigmask(&attr, sigmask);
+		posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+		pattr = &attr;
+	}
+
+	if (nr_redirections) {
+		posix_spawn_file_actions_init(&actions);
+		for (int i = 0; i < nr_redirections; i++) {
+			const struct redirection *r = redirections + i;
+
+			if (r->target == r->fd) continue;
+			posix_spawn_file_actions_adddup2(&actions, r->target, r->fd);
+		}
+		pactions = &actions;
+	}
+
+	if (path) {
+		ret = posix_spawn(&pid, path, pactions, pattr, argv, environ);
+	} else {
+		ret = posix_spawnp(&pid, argv[0], pactions, pattr, argv, environ);
+	}
+	if (pactions) posix_spawn_file_actions_destroy(pactions);
+	if (pattr) posix_spawnattr_destroy(pattr);
+	if (ret) return -ret;
+
+	return pid;
+}
+
+/**
+ * Unlike posix_spawn(), fork() and exec() do not tell the parent whether exec
+ * has failed. The child writes errno to a close-on-exec pipe instead, so the
+ * parent reads either the errno or the end of the pipe on a successful exec.
+ */
+static pid_t __launch_fork(const char *path, char * const argv[],
+		const struct redirection *redirections, int nr_redirections,
+		void (*setup)(void *data), void *data)
+{
+	int fds[2];
+	int error;
+	ssize_t nr_read;
+	pid_t pid;
+
+	if (pipe2(fds, O_CLOEXEC)) return -errno;
+
+	pid = fork();
+	if (pid < 0) {
+		error = errno;
+		close(fds[0]);
+		close(fds[1]);
+		return -error;
+	}
+
+	if (pid == 0) {
+		const sigset_t *sigmask = reaper_sigmask();
+
+		close(fds[0]);
+		if (sigmask) sigprocmask(SIG_SETMASK, sigmask, NULL);
+
+		for (int i = 0; i < nr_redirections; i++) {
+			const struct redirection *r = redirections + i;
+
+			if (r->target != r->fd) dup2(r->target, r->fd);
+		}
+		if (setup) setup(data);
+
+		if (path) {
+			execv(path, argv);
+		} else {
+			execvp(argv[0], argv);
+		}
+		error = errno;
+		write(fds[1], &error, sizeof(error));
+
+		/* Do not flush the stdio buffers shared with the shell */
+		_exit(127);
+	}
+
+	close(fds[1]);
+	do {
+		nr_read = read(fds[0], &error, sizeof(error));
+	} while (nr_read < 0 && errno == EINTR);
+	close(fds[0]);
+
+	if (nr_read == sizeof(error)) {
+		waitpid(pid, NULL, 0);
+		return -error;
+	}
+
+	return pid;
+}
+
+static pid_t __launch(enum launch_methods method, const char *path,
+		char * const argv[],
+		const struct redirection *redirections, int nr_redirections,
+		void (*setup)(void *data), void *data)
+{
+	if (method == launch_spawn) {
+		return __launch_spawn(path, argv, redirections, nr_redirections);
+	}
+	if (method == launch_zygote) {
+		struct redirection stdio[ZYGOTE_MAX_REDIRECTIONS] = {
+			{ STDIN_FILENO, STDIN_FILENO },
+			{ STDOUT_FILENO, STDOUT_FILENO },
+			{ STDERR_FILENO, STDERR_FILENO },
+		};
+		pid_t pid;
+
+		/* Commands get the streams of the zygote unless passed over */
+		if (shell_redirected() && nr_redirections + 3 <= ZYGOTE_MAX_REDIRECTIONS) {
+			memcpy(stdio + 3, redirections, sizeof(*stdio) * nr_redirections);
+			redirections = stdio;
+			nr_redirections += 3;
+		}
+
+		pid = zygote_launch(path, argv, redirections, nr_redirections);
+
+		/* Carry on without the zygote if it is gone */
+		if (pid != -EPIPE) return pid;
+		return __launch_spawn(path, argv, redirections, nr_redirections);
+	}
+
+	return __launch_fork(path, argv, redirections, nr_redirections,
+			setup, data);
+}
+
+pid_t launch_command_redirected(char * const argv[],
+		const struct redirection *redirections, int nr_redirections,
+		void (*setup)(void *data), void *data)
+{
+	enum launch_methods method = launch_spawn;
+	const char *path = lookup_command(argv[0]);
+	pid_t pid;
+
+	/* Keep the order with the output of utilities (see utility.h) */
+	fflush(stdout);
+
+	if (setup) {
+		method = launch_fork;
+	} else if (zygote_running()) {
+		method = launch_zygote;
+	}
+
+	pid = __launch(method, path, argv, redirections, nr_redirections,
+			setup, data);
+
+	/* The cached executable is gone. Walk $PATH again */
+	if (pid == -ENOENT && path) {
+		forget_command(argv[0]);
+		pid = __launch(method, lookup_command(argv[0]), argv,
+				redirections, nr_redirections, setup, data);
+	}
+
+	return pid;
+}
+
+pid_t launch_command(char * const argv[], void (*setup)(void *data), void *data)
+{
+	return launch_command_redirected(argv, NULL, 0, setup, data);
+}
+
+
+/***********************************************************************
+ * Launch benchmark
+ */
+static double __now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int __compare_latency(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+static int __benchmark(int nr_launches, char * const argv[], double *latencies)
+{
+	static const struct {
+		enum launch_methods method;
+		bool cached;
+		const char *name;
+	} methods[] = {
+		{ launch_fork, false, "fork+execvp" },
+		{ launch_spawn, false, "posix_spawnp" },
+		{ launch_spawn, true, "posix_spawn+hash" },
+		{ launch_zygote, true, "zygote+hash" },
+	};
+
+	for (int i = 0; i < sizeof(methods) / sizeof(*methods); i++) {
+		double elapsed = __now();
+
+		if (methods[i].method == launch_zygote && !zygote_running()) continue;
+
+		for (int n = 0; n < nr_launches; n++) {
+			const char *path = methods[i].cached ?
+					lookup_command(argv[0]) : NULL;
+			double started = __now();
+			pid_t pid = __launch(methods[i].method, path, argv,
+					NULL, 0, NULL, NULL);
+
+			if (pid < 0) {
+				fprintf(stderr, "Unable to launch %s: %s\n",
+						argv[0], strerror(-pid));
+				return pid;
+			}
+			waitpid(pid, NULL, 0);
+			latencies[n] = __now() - started;
+		}
+		elapsed = __now() - elapsed;
+
+		qsort(latencies, nr_launches, sizeof(*latencies), __compare_latency);
+
+		fprintf(stderr, "  %-16s: %8.1f launches/s, "
+				"p50 %8.1f usec, p99 %8.1f usec\n",
+				methods[i].name, nr_launches / elapsed,
+				latencies[nr_launches / 2] * 1e6,
+				latencies[nr_launches * 99 / 100] * 1e6);
+	}
+
+	return 0;
+}
+
+int benchmark_launch(int nr_launches, char * const argv[])
+{
+	double *latencies;
+	char *ballast = NULL;
+	int ret;
+
+	latencies = malloc(sizeof(*latencies) * nr_launches);
+	if (!latencies) return -ENOMEM;
+
+	/* Started while the shell is small, as initialize() does */
+	if ((ret = init_zygote())) {
+		fprintf(stderr, "Unable to start the zygote: %s\n", strerror(-ret));
+	}
+
+	fprintf(stderr, "Launching %s %d times\n", argv[0], nr_launches);
+	ret = __benchmark(nr_launches, argv, latencies);
+
+	if (!ret) ballast = malloc(BENCHMARK_BALLAST);
+	if (ballast) {
+		/* Touch every page so that fork() has to copy its page tables */
+		memset(ballast, 0xa5, BENCHMARK_BALLAST);
+
+		fprintf(stderr, "Launching %s %d times with %d MiB more memory\n",
+				argv[0], nr_launches, BENCHMARK_BALLAST >> 20);
+		ret = __benchmark(nr_launches, argv, latencies);
+		free(ballast);
+	}
+
+	fini_zygote();
+	free(latencies);
+
+	return ret;
+}
@@ -0,0 +1,90 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __LAUNCH_H__
+#define __LAUNCH_H__
+
+#include <sys/types.h>
+
+enum launch_methods {
+	launch_spawn = 0,	/* posix_spawn(); no page table copy */
+	launch_fork,		/* fork() and exec() */
+	launch_zygote,		/* By the zygote; see zygote.h */
+};
+
+/***********************************************************************
+ * launch_command()
+ *
+ * DESCRIPTION
+ *  Start @argv[0] with @argv as a child process. If @setup is given, it is
+ *  called with @data in the child right before exec, so the command is
+ *  launched with fork(). Otherwise the command is launched by the zygote if
+ *  it is running, or with posix_spawn(), which does not copy the page tables
+ *  of the shell.
+ *
+ *  The executable is resolved through the path cache (see pathcache.h), and
+ *  is looked up again if the cached one is gone.
+ *
+ *  When the command cannot be executed in the forked child, the child prints
+ *  the error and exits with 127.
+ *
+ * RETURN VALUE
+ *  Return the pid of the child
+ *  Return -errno if the command cannot be launched
+ *
+ */
+pid_t launch_command(char * const argv[], void (*setup)(void *data), void *data);
+
+
+/**
+ * Make @fd of the child a duplicate of @target of the shell.
+ */
+struct redirection {
+	int fd;
+	int target;
+};
+
+/***********************************************************************
+ * launch_command_redirected()
+ *
+ * DESCRIPTION
+ *  Same as launch_command() but set up @redirections in the child first.
+ *  File descriptors of the shell to be passed to children should not be
+ *  inherited by others, so open them with O_CLOEXEC.
+ *
+ */
+pid_t launch_command_redirected(char * const argv[],
+		const struct redirection *redirections, int nr_redirections,
+		void (*setup)(void *data), void *data);
+
+/***********************************************************************
+ * benchmark_launch()
+ *
+ * DESCRIPTION
+ *  Launch and wait for @argv @nr_launches times with each launch method,
+ *  and report the number of commands launched per second along with the
+ *  median and the 99th percentile of the time taken for each launch. The
+ *  command is looked up in $PATH on each launch unless the path cache is
+ *  used. All methods are measured again after the shell grows by
+ *  BENCHMARK_BALLAST bytes to show how the size of the shell matters.
+ *
+ * RETURN VALUE
+ *  Return 0 on success, -errno otherwise
+ *
+ */
+#define BENCHMARK_BALLAST	(256 << 20)
+int benchmark_launch(int nr_launches, char * const argv[]);
+
+#endif
@@ -0,0 +1,252 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "types.h"
+#include "keywords.h"
+#include "launchopt.h"
+
+static const struct {
+	const char *name;
+	int resource;
+	bool bytes;		/* Takes a K, M, or G suffix */
+} __resources[] = {
+	{ "mem", RLIMIT_AS, true },
+	{ "stack", RLIMIT_STACK, true },
+	{ "fsize", RLIMIT_FSIZE, true },
+	{ "core", RLIMIT_CORE, true },
+	{ "cpu", RLIMIT_CPU, false },
+	{ "nofile", RLIMIT_NOFILE, false },
+	{ "nproc", RLIMIT_NPROC, false },
+};
+
+/* Parse "2-5" or "0,2,4-7" */
+static int __parse_cpus(const char *list, cpu_set_t *cpus)
+{
+	const char *p = list;
+	int nr_cpus = 0;
+
+	CPU_ZERO(cpus);
+
+	while (*p) {
+		char *end;
+		long first, last;
+
+		first = last = strtol(p, &end, 10);
+		if (end == p) return -EINVAL;
+
+		if (*end == '-') {
+			p = end + 1;
+			last = strtol(p, &end, 10);
+			if (end == p) return -EINVAL;
+		}
+		if (first < 0 || last < first || last >= CPU_SETSIZE) return -EINVAL;
+
+		for (long cpu = first; cpu <= last; cpu++) {
+			if (!CPU_ISSET(cpu, cpus)) nr_cpus++;
+			CPU_SET(cpu, cpus);
+		}
+
+		if (*end == ',') end++;
+		else if (*end) return -EINVAL;
+		p = end;
+	}
+	return nr_cpus ? nr_cpus : -EINVAL;
+}
+
+/* Parse "mem=1G" */
+static int __parse_limit(const char *token, struct launch_options *options)
+{
+	const char *value = strchr(token, '=');
+	unsigned long long number;
+	unsigned int shift = 0;
+	char *end;
+
+	if (!value) return -EINVAL;
+	value++;
+
+	for (int i = 0; i < sizeof(__resources) / sizeof(*__resources); i++) {
+		if (strncmp(token, __resources[i].name, value - token - 1) ||
+				__resources[i].name[value - token - 1]) continue;
+
+		if (options->nr_limits == LAUNCHOPT_MAX_LIMITS) return -E2BIG;
+
+		errno = 0;
+		number = strtoull(value, &end, 10);
+		if (end == value || *value == '-' || errno == ERANGE) return -EINVAL;
+
+		if (__resources[i].bytes) {
+			switch (*end) {
+			case 'G': case 'g':
+				shift += 10;
+				/* fall through */
+			case 'M': case 'm':
+				shift += 10;
+				/* fall through */
+			case 'K': case 'k':
+				shift += 10;
+				end++;
+				break;
+			}
+		}
+		if (*end) return -EINVAL;
+
+		/* RLIM_INFINITY itself means no limit */
+		if (number >= (RLIM_INFINITY >> shift)) return -ERANGE;
+		number <<= shift;
+
+		options->limits[options->nr_limits].resource = __resources[i].resource;
+		options->limits[options->nr_limits].value = number;
+		options->nr_limits++;
+		return 0;
+	}
+	return -EINVAL;
+}
+
+int parse_launch_options(int nr_tokens, char * const tokens[],
+		struct launch_options *options)
+{
+	int i = 0;
+
+	memset(options, 0x00, sizeof(*options));
+
+	while (i < nr_tokens) {
+		switch (keyword_lookup(tokens[i], strlen(tokens[i]))) {
+		case KW_PIN:
+			i++;
+			if (i < nr_tokens && strcmp(tokens[i], "-r") == 0) {
+				options->round_robin = true;
+				i++;
+			}
+			if (i >= nr_tokens ||
+					(options->nr_cpus = __parse_cpus(tokens[i], &options->cpus)) < 0) {
+				fprintf(stderr, "pin: invalid CPU list %s\n",
+						i < nr_tokens ? tokens[i] : "");
+				return -EINVAL;
+			}
+			options->pin = true;
+			i++;
+			break;
+
+		case KW_NICE: {
+			long niceness = 0;
+			char *end = NULL;
+
+			i++;
+			if (i < nr_tokens) niceness = strtol(tokens[i], &end, 10);
+			if (i >= nr_tokens || end == tokens[i] || *end) {
+				fprintf(stderr, "nice: invalid niceness %s\n",
+						i < nr_tokens ? tokens[i] : "");
+				return -EINVAL;
+			}
+			/* Chained ones add up as nice(1) does */
+			options->niceness += niceness;
+			options->nice = true;
+			i++;
+			break;
+		}
+
+		case KW_LIMIT:
+			i++;
+			if (i >= nr_tokens || !strchr(tokens[i], '=')) {
+				fprintf(stderr, "limit: no resource is given\n");
+				return -EINVAL;
+			}
+			for (; i < nr_tokens && strchr(tokens[i], '='); i++) {
+				int ret = __parse_limit(tokens[i], options);
+
+				if (ret == -ERANGE) {
+					fprintf(stderr, "limit: %s is too large\n", tokens[i]);
+					return -EINVAL;
+				} else if (ret) {
+					fprintf(stderr, "limit: invalid limit %s\n", tokens[i]);
+					return -EINVAL;
+				}
+			}
+			break;
+
+		default:
+			return i;
+		}
+	}
+
+	fprintf(stderr, "%s: no command is given\n", tokens[0]);
+	return -EINVAL;
+}
+
+void apply_launch_options(void *data)
+{
+	struct launch_options *options = data;
+
+	if (options->pin) {
+		cpu_set_t cpus = options->cpus;
+
+		if (options->round_robin) {
+			int nth = options->nr_launches % options->nr_cpus;
+
+			CPU_ZERO(&cpus);
+			for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+				if (!CPU_ISSET(cpu, &options->cpus) || nth--) continue;
+
+				CPU_SET(cpu, &cpus);
+				break;
+			}
+		}
+		if (sched_setaffinity(0, sizeof(cpus), &cpus)) {
+			perror("pin");
+			_exit(126);
+		}
+	}
+
+	if (options->nice) {
+		int niceness;
+
+		errno = 0;
+		niceness = getpriority(PRIO_PROCESS, 0);
+		if ((niceness == -1 && errno) ||
+				setpriority(PRIO_PROCESS, 0, niceness + options->niceness)) {
+			perror("nice");
+			_exit(126);
+		}
+	}
+
+	for (int i = 0; i < options->nr_limits; i++) {
+		/* The command cannot raise it back */
+		struct rlimit rlim = {
+			.rlim_cur = options->limits[i].value,
+			.rlim_max = options->limits[i].value,
+		};
+
+		if (setrlimit(options->limits[i].resource, &rlim)) {
+			perror("limit");
+			_exit(126);
+		}
+	}
+}
+
+void launched_with_options(struct launch_options *options)
+{
+	options->nr_launches++;
+}
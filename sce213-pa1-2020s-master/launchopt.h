@@ -0,0 +1,85 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __LAUNCHOPT_H__
+#define __LAUNCHOPT_H__
+
+#include <sched.h>
+#include <sys/resource.h>
+
+#define LAUNCHOPT_MAX_LIMITS	8
+
+/**
+ * Settings applied to a command in the child right before exec. They are
+ * given as prefixes of the command, and can be chained:
+ *
+ *   pin [-r] CPUS command ...      Run on CPUS such as "2-5" or "0,2,4-7".
+ *                                  With -r, each launch goes to the next
+ *                                  CPU in CPUS, e.g., "for 8 pin -r 0-3 cmd"
+ *                                  runs two iterations on each CPU.
+ *   nice N command ...             Add N to the nice value
+ *   limit RES=VALUE ... command ...
+ *                                  Limit the resources; mem (address space)
+ *                                  and stack, fsize and core in bytes with
+ *                                  an optional K, M, or G suffix, cpu in
+ *                                  seconds, and nofile and nproc in numbers
+ */
+struct launch_options {
+	bool pin;
+	bool round_robin;
+	cpu_set_t cpus;
+	int nr_cpus;
+	unsigned long nr_launches;	/* Picks the CPU to run on with -r */
+
+	bool nice;
+	int niceness;
+
+	int nr_limits;
+	struct {
+		int resource;
+		rlim_t value;
+	} limits[LAUNCHOPT_MAX_LIMITS];
+};
+
+/***********************************************************************
+ * parse_launch_options()
+ *
+ * DESCRIPTION
+ *  Parse the prefixes at the beginning of @tokens into @options. Errors are
+ *  reported to stderr.
+ *
+ * RETURN VALUE
+ *  Return the index of the command in @tokens; 0 if there is no prefix
+ *  Return -EINVAL if the prefixes are malformed or no command follows
+ *
+ */
+int parse_launch_options(int nr_tokens, char * const tokens[],
+		struct launch_options *options);
+
+/***********************************************************************
+ * apply_launch_options()
+ *
+ * DESCRIPTION
+ *  Apply @data, a struct launch_options, to the calling process. This is
+ *  the setup callback of launch_command(), and exits with 126 if any of
+ *  them cannot be applied. Call launched_with_options() after each launch
+ *  to move on to the next CPU.
+ *
+ */
+void apply_launch_options(void *data);
+void launched_with_options(struct launch_options *options);
+
+#endif
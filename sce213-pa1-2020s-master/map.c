@@ -0,0 +1,224 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "types.h"
+#include "parser.h"
+#include "keywords.h"
+#include "launch.h"
+#include "reaper.h"
+#include "map.h"
+
+#define MAP_SLOT	"{}"
+
+struct map {
+	char * const *template;
+	int nr_template;
+	int nr_slots;		/* Number of MAP_SLOT in @template */
+
+	char **items;
+	int nr_items;
+
+	char **argv;
+	int devnull;
+	unsigned int timeout;
+
+	int nr_running;
+	unsigned long nr_runs;
+	unsigned long nr_failed;
+};
+
+static double __now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void __print_usage(void)
+{
+	fprintf(stderr, "Usage: command ... | map [-j J] [-n N] command ... {}\n");
+}
+
+/* Collect a finished run */
+static void __collect(struct map *map)
+{
+	struct child *child = wait_any_child(map);
+
+	if (!child) {
+		map->nr_running = 0;
+		return;
+	}
+
+	if (!WIFEXITED(child->status) || WEXITSTATUS(child->status)) {
+		map->nr_failed++;
+	}
+	release_child(child);
+	map->nr_running--;
+}
+
+/* Run the template with the items in the batch */
+static void __launch(struct map *map)
+{
+	struct redirection redirections[] = {
+		{ STDIN_FILENO, map->devnull },
+	};
+	struct child *child;
+	char **argv = map->argv;
+	pid_t pid;
+
+	for (int i = 0; i < map->nr_template; i++) {
+		if (strcmp(map->template[i], MAP_SLOT)) {
+			*argv++ = map->template[i];
+			continue;
+		}
+		memcpy(argv, map->items, sizeof(*argv) * map->nr_items);
+		argv += map->nr_items;
+	}
+	if (!map->nr_slots) {
+		memcpy(argv, map->items, sizeof(*argv) * map->nr_items);
+		argv += map->nr_items;
+	}
+	*argv = NULL;
+
+	map->nr_runs++;
+
+	/* The command is loaded when launch returns, so argv can go */
+	pid = launch_command_redirected(map->argv, redirections, 1, NULL, NULL);
+	if (pid < 0) {
+		fprintf(stderr, "map: %s: %s\n", map->argv[0], strerror(-pid));
+		map->nr_failed++;
+		return;
+	}
+
+	child = watch_child(pid, map->argv[0], map->timeout);
+	if (!child) {
+		waitpid(pid, NULL, 0);
+		return;
+	}
+	child->owner = map;
+	map->nr_running++;
+}
+
+int run_map(int nr_tokens, char * const tokens[], int in, unsigned int timeout)
+{
+	struct map map = {
+		.timeout = timeout,
+	};
+	struct command_stream items;
+	int nr_jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	int batch = 1;
+	int i = 1, t = 0;
+	unsigned long nr_items = 0;
+	bool eof = false;
+	double started;
+
+	while (i + 1 < nr_tokens) {
+		if (strcmp(tokens[i], "-j") == 0) {
+			nr_jobs = atoi(tokens[i + 1]);
+		} else if (strcmp(tokens[i], "-n") == 0) {
+			batch = atoi(tokens[i + 1]);
+		} else {
+			break;
+		}
+		i += 2;
+	}
+
+	if (i >= nr_tokens || nr_jobs <= 0 || batch <= 0) {
+		__print_usage();
+		return 1;
+	}
+	if (keyword_lookup(tokens[i], strlen(tokens[i])) != KW_NONE) {
+		fprintf(stderr, "map: %s is a built-in command\n", tokens[i]);
+		return 1;
+	}
+
+	map.template = tokens + i;
+	map.nr_template = nr_tokens - i;
+	for (int j = 0; j < map.nr_template; j++) {
+		if (strcmp(map.template[j], MAP_SLOT) == 0) map.nr_slots++;
+	}
+
+	map.items = calloc(batch, sizeof(*map.items));
+	map.argv = malloc(sizeof(*map.argv) *
+			(map.nr_template + (map.nr_slots ? map.nr_slots : 1) * batch + 1));
+	map.devnull = open("/dev/null", O_RDONLY | O_CLOEXEC);
+	if (!map.items || !map.argv || map.devnull < 0) {
+		fprintf(stderr, "map: %s\n", strerror(map.devnull < 0 ? errno : ENOMEM));
+		goto out;
+	}
+
+	init_command_stream(&items, in);
+	started = __now();
+
+	while (!eof) {
+		/* Fill a batch. The tokens are gone on the next read */
+		while (map.nr_items < batch) {
+			char *item;
+
+			if (t == items.tv.nr_tokens) {
+				if (read_command(&items) <= 0) {
+					eof = true;
+					break;
+				}
+				t = 0;
+				continue;
+			}
+
+			if (!(item = strdup(items.tv.tokens[t++]))) {
+				eof = true;
+				break;
+			}
+			map.items[map.nr_items++] = item;
+		}
+		if (!map.nr_items) break;
+
+		while (map.nr_running >= nr_jobs) __collect(&map);
+
+		__launch(&map);
+
+		nr_items += map.nr_items;
+		while (map.nr_items) free(map.items[--map.nr_items]);
+	}
+
+	while (map.nr_running) __collect(&map);
+
+	free_command_stream(&items);
+
+	started = __now() - started;
+	fprintf(stderr, "map: %lu item%s in %lu run%s (%lu failed) in %.3f s, "
+			"%.1f items/s with up to %d at once\n",
+			nr_items, nr_items == 1 ? "" : "s",
+			map.nr_runs, map.nr_runs == 1 ? "" : "s", map.nr_failed,
+			started, started > 0 ? nr_items / started : 0.0, nr_jobs);
+
+out:
+	if (map.devnull >= 0) close(map.devnull);
+	free(map.argv);
+	free(map.items);
+
+	return 1;
+}
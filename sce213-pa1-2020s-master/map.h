@@ -0,0 +1,41 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __MAP_H__
+#define __MAP_H__
+
+/***********************************************************************
+ * run_map()
+ *
+ * DESCRIPTION
+ *  The map built-in command:
+ *   command ... | map [-j J] [-n N] command ... {}
+ *
+ *  Read items from @in, tokenized as command lines are, and run the command
+ *  for every N items (1 by default) with the items in place of each "{}", or
+ *  after the arguments if there is no "{}". Up to J (the number of processors
+ *  by default) commands run at once, reading from /dev/null. Each command is
+ *  killed when it runs longer than @timeout seconds unless @timeout is 0.
+ *  The number of items and runs and the items per second are reported at the
+ *  end.
+ *
+ * RETURN VALUE
+ *  Return 1 as run_command() does
+ *
+ */
+int run_map(int nr_tokens, char * const tokens[], int in, unsigned int timeout);
+
+#endif
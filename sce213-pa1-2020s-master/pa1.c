@@ -20,10 +20,29 @@
 #include <unistd.h> // for execvp function
 #include <sys/types.h>
 #include <sys/wait.h> // for wait function
-#include <signal.h> // for sigaction
+#include <errno.h>
+#include <limits.h>
 
 #include "types.h"
 #include "parser.h"
+#include "keywords.h"
+#include "launch.h"
+#include "pathcache.h"
+#include "pfor.h"
+#include "reaper.h"
+#include "pipeline.h"
+#include "jobs.h"
+#include "zygote.h"
+#include "script.h"
+#include "instrument.h"
+#include "map.h"
+#include "dircache.h"
+#include "launchopt.h"
+#include "redirect.h"
+#include "utility.h"
+#include "env.h"
+#include "wildcard.h"
+#include "history.h"
 
 /*====================================================================*/
 /*          ****** DO NOT MODIFY ANYTHING FROM THIS LINE ******       */
@@ -65,132 +84,389 @@ static void set_timeout(unsigned int timeout)
  *   Return 0 when user inputs "exit"
  *   Return <0 on error
  */
-static char* name;
-static void sig_handler(int sig);
 static int takenTime;
-static pid_t pid; // process id
 
-static int run_command(int nr_tokens, char *tokens[])
+/* Launch commands through the zygote (MYSH_ZYGOTE) */
+static bool __use_zygote = false;
+
+static enum keyword __keyword(const char *token)
+{
+	return token ? keyword_lookup(token, strlen(token)) : KW_NONE;
+}
+
+/**
+ * Launch @argv and wait for it to exit. The reaper kills it if it runs longer
+ * than the timeout. @options and @redirections are applied to the child if
+ * given.
+ */
+static int __run_external(char *argv[], struct launch_options *options,
+		struct redirections *redirections)
+{
+	struct redirection *r = redirections ? redirections->r : NULL;
+	int nr = redirections ? redirections->nr : 0;
+	struct utility *utility = options ? NULL : lookup_utility(argv[0]);
+	struct child *child;
+	double started, launched;
+	pid_t pid;
+
+	/* No need to launch a process for echo and the like */
+	if (utility) {
+		if (nr) swap_redirections(redirections);
+		run_utility(utility, argv);
+		if (nr) swap_redirections(redirections);
+		return 0;
+	}
+
+	// searches for the location of the argv[0] command 
+	// passes arguments to the argv[0] command in the argv array
+	started = instrument_now();
+	if (options) {
+		pid = launch_command_redirected(argv, r, nr, apply_launch_options, options);
+		launched_with_options(options);
+	} else {
+		pid = launch_command_redirected(argv, r, nr, NULL, NULL);
+	}
+	launched = instrument_now();
+	if(pid < 0) {
+		fprintf(stderr, "No such file or directory\n");
+		return pid;
+	}
+
+	child = watch_child(pid, argv[0], takenTime);
+	if(child == NULL) {
+		waitpid(pid, NULL, 0);
+		return -ENOMEM;
+	}
+
+	wait_child(child); // wait for process to change state
+
+	if (instrumenting()) {
+		record_phase(PHASE_LAUNCH, started, launched);
+		record_phase(PHASE_RUN, launched, child->reaped_at);
+		record_phase(PHASE_WAIT, child->reaped_at, instrument_now());
+	}
+	release_child(child);
+
+	return 0;
+}
+
+static int __run_command(int nr_tokens, char *tokens[])
 {
 	/* This function is all yours. Good luck! */
+	struct redirections redirections;
+	enum keyword keyword;
 
-	
-	name = (char*)malloc(sizeof(char)*MAX_TOKEN_LEN);
-	name = tokens[0];
+	if (is_background(&nr_tokens, tokens))
+		return run_background(nr_tokens, tokens, takenTime);
 
-	if (strncmp(tokens[0], "exit", strlen("exit")) == 0) {
-		return 0;
+	/* time times the whole pipeline */
+	for (int i = 0; i < nr_tokens && __keyword(tokens[0]) != KW_TIME; i++) {
+		if (__keyword(tokens[i]) == KW_PIPE)
+			return run_pipeline(nr_tokens, tokens, takenTime);
 	}
 
-	else if(strncmp(tokens[0], "prompt", strlen("prompt")) == 0) { // command is prompt
-		strcpy(__prompt, tokens[1]);
+	/* tee alone is a pipeline of the shell relaying stdin to stdout */
+	if (__keyword(tokens[0]) == KW_TEE)
+		return run_pipeline(nr_tokens, tokens, takenTime);
+
+	if (open_redirections(&nr_tokens, tokens, &redirections))
+		return 1;
+	if (nr_tokens == 0) {
+		close_redirections(&redirections);
+		return 1;
 	}
 
-	else if(strncmp(tokens[0], "cd", strlen("cd")) == 0) {
-		// cd ~ and cd : go to the home directory of user
-		if(strncmp(tokens[1], "~", strlen("~")) == 0 || tokens[1] == NULL)
-		// getenv : searches the environment list to find the environment variable name
-			chdir(getenv("HOME")); 
-		else 
-		// chdir : changes the current working directory of the calling process to the path directory
-			chdir(tokens[1]); 
+	keyword = __keyword(tokens[0]);
+	if (redirections.nr && keyword != KW_NONE &&
+			keyword != KW_PIN && keyword != KW_NICE && keyword != KW_LIMIT) {
+		int ret;
+
+		/* Built-in commands use the streams of the shell. Redirect them meanwhile */
+		swap_redirections(&redirections);
+		ret = __run_command(nr_tokens, tokens);
+		swap_redirections(&redirections);
+
+		return ret;
 	}
+
+	switch (keyword) {
+	case KW_EXIT:
+		return 0;
+
+	case KW_PROMPT: // command is prompt
+		strcpy(__prompt, tokens[1]);
+		break;
+
+	case KW_CD:
+		// cd ~ and cd : go to the home directory of user
+		// the directory is opened once and switched to with fchdir() later
+		return run_cd(nr_tokens, tokens);
+
+	case KW_PUSHD:
+		return run_pushd(nr_tokens, tokens);
+
+	case KW_POPD:
+		return run_popd(nr_tokens, tokens);
+
+	case KW_DIRS:
+		return run_dirs(nr_tokens, tokens);
 	
-	else if(strncmp(tokens[0], "timeout", strlen("timeout")) == 0) {
-		takenTime = atoi(tokens[1]); // casting from char* to int
+	case KW_TIMEOUT:
 		if(tokens[1] == NULL) 
-			fprintf(stderr, "Current timeout is %d second", takenTime);
+			fprintf(stderr, "Current timeout is %d second\n", takenTime);
 		else
 		{
 			set_timeout(atoi(tokens[1])); 
 			takenTime = atoi(tokens[1]);
 		}
-		
+		break;
+
+	case KW_HASH:
+		return run_hash(nr_tokens, tokens);
+
+	case KW_PFOR:
+		return run_pfor(nr_tokens, tokens, takenTime);
+
+	case KW_JOBS:
+		return run_jobs(nr_tokens, tokens);
+
+	case KW_WAIT:
+		return run_wait(nr_tokens, tokens);
+
+	case KW_FG:
+		return run_fg(nr_tokens, tokens);
+
+	case KW_MAP:
+		/* Commands read from stdin otherwise, so take items from terminals only */
+		if (!isatty(STDIN_FILENO)) {
+			fprintf(stderr, "map: pipe the items in as in \"ls | map wc -l {}\"\n");
+			break;
+		}
+		return run_map(nr_tokens, tokens, STDIN_FILENO, takenTime);
+
+	case KW_ENABLE:
+		return run_enable(nr_tokens, tokens);
+
+	case KW_EXPORT:
+		return run_export(nr_tokens, tokens);
+
+	case KW_UNSET:
+		return run_unset(nr_tokens, tokens);
+
+	case KW_HISTORY:
+		return run_history(nr_tokens, tokens);
+
+	case KW_TIME: {
+		struct rusage usage;
+		double started;
+		int ret;
+
+		if (nr_tokens < 2) {
+			fprintf(stderr, "time: usage: time command ...\n");
+			break;
+		}
+
+		/* Leave out the children exited before */
+		reap_children();
+		take_rusage(&usage);
+
+		started = instrument_now();
+		ret = __run_command(nr_tokens - 1, tokens + 1);
+
+		reap_children();
+		take_rusage(&usage);
+
+		fprintf(stderr, "\nreal\t%.3fs\nuser\t%.3fs\nsys\t%.3fs\nmaxrss\t%ld KiB\n",
+				instrument_now() - started,
+				usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6,
+				usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6,
+				usage.ru_maxrss);
+		return ret;
 	}
 
-	else if(strncmp(tokens[0], "for", strlen("for")) == 0) {
+	case KW_FOR: {
 		int N_times = 1; 
 		int num = 0;
 
+		/* for N pfor M ... runs in parallel as well */
+		while (__keyword(tokens[num]) == KW_FOR && num + 2 < nr_tokens)
+			num += 2;
+		if (__keyword(tokens[num]) == KW_PFOR)
+			return run_pfor(nr_tokens, tokens, takenTime);
+		num = 0;
+
 		for(int i=0; i<nr_tokens; i++) {
-			if(strncmp(tokens[i], "for", strlen("for")) == 0) {
-				N_times *= atoi(tokens[i + 1]); // calculate N-times
-				if(strncmp(tokens[i + 2], "for", strlen("for")) != 0) { 
+			if(__keyword(tokens[i]) == KW_FOR) {
+				int n = atoi(tokens[i + 1]);
+
+				if (n < 0) n = 0;
+				if (n > 0 && N_times > INT_MAX / n) {
+					fprintf(stderr, "for: too many iterations\n");
+					N_times = 0;
+					break;
+				}
+				N_times *= n; // calculate N-times
+				if(__keyword(tokens[i + 2]) != KW_FOR) { 
 					num = i + 2;	// if the tokens[i+2] is not 'for', save the index
 				}
 			}
 		}
 
-		if(strncmp(tokens[num], "cd", strlen("cd")) == 0) { // use the information of num 
+		if(__keyword(tokens[num]) == KW_CD) { // use the information of num 
 			for(int i=0; i<N_times; i++)  { // 
-				if(strncmp(tokens[num + 1], "~", strlen("~")) == 0 || tokens[num + 1] == NULL)
-					chdir(getenv("HOME")); 
-				else 
-					chdir(tokens[num + 1]); 
+				if (change_directory(tokens[num + 1]))
+					break;
 			}
 		}
 
 		else { // tokens[num] 
+			struct launch_options options;
+			int skip = parse_launch_options(nr_tokens - num, &tokens[num], &options);
+
+			if (skip < 0)
+				break;
+
 			for(int i=0; i<N_times; i++) {
-				pid = fork();
-
-				if(pid < 0) {
-					fprintf(stderr, "fork failed\n");
-					exit(1); 
-				}                                                                                                                             
-				else if(pid == 0) { /* child process */
-					
-					execvp(tokens[num],&tokens[num]);
-					if(tokens[num] != NULL){
-						fprintf(stderr, "No such file or directory\n");
-					}
-					close(pid);
-					exit(0); 
-				} 
-				else /* parent process */ 
-					wait(NULL); // wait for process to change state
-				}
+				if(__run_external(&tokens[num + skip], skip ? &options : NULL, NULL) < 0)
+					break;
+			}
 		}
+		break;
 	}
 
-	else {
-			// change the action taken by a process on receipt of a specific signal
-			struct sigaction act; 
-			act.sa_handler = sig_handler;
-			sigaction(SIGALRM, &act, 0);
-			alarm(takenTime); // send SIGALRM to me at the takneTime
-
-			pid = fork(); // create a child process 
-			
-			if(pid < 0) {
-				fprintf(stderr, "fork failed\n");
-				exit(1); // EXIT_FAILURE
-			}                                                                                                                             
-			else if(pid == 0) { /* child process */
-				// searches for the location of the tokens[0] command 
-				// passes arguments to the tokens[0] command in the tokens array
-				execvp(tokens[0],tokens);
-				if(tokens[0] != NULL){	
-					fprintf(stderr, "No such file or directory\n");
-				}
-				close(pid);
-				exit(0); // EXIT_SUCCESS
-			} 
-			else /* parent process */ 
-				wait(NULL); // wait for process to change state
-		}
+	case KW_PIN:
+	case KW_NICE:
+	case KW_LIMIT: {
+		struct launch_options options;
+		int skip = parse_launch_options(nr_tokens, tokens, &options);
+
+		if (skip > 0)
+			__run_external(tokens + skip, &options, &redirections);
+		break;
+	}
+
+	default:
+		__run_external(tokens, NULL, &redirections);
+		break;
+	}
 
+	close_redirections(&redirections);
 	return 1;
 }
 
-static void sig_handler(int sig)
+/* Expand the wildcards once for the whole command line, then run it */
+static int __run_line(int nr_tokens, char *tokens[])
+{
+	struct wildcards wildcards;
+	int ret;
+
+	if ((ret = expand_wildcards(nr_tokens, tokens, &wildcards))) {
+		fprintf(stderr, "Unable to expand wildcards: %s\n", strerror(-ret));
+		return 1;
+	}
+
+	ret = __run_command(wildcards.nr_tokens, wildcards.tokens);
+	release_wildcards(&wildcards);
+
+	return ret;
+}
+
+/* Commands read by main() from stdin */
+static struct command_stream __commands;
+static double __parse_started;
+
+/**
+ * Wait for more of the command line. The parse phase starts over once the
+ * bytes are in, so the time the user takes to type is not counted as parsing.
+ */
+static int __wait_command(int fd)
+{
+	int ret = wait_readable(fd);
+
+	__parse_started = instrument_now();
+	return ret;
+}
+
+static int run_command(int nr_tokens, char *tokens[])
+{
+	int ret = 1;
+
+	record_history(nr_tokens, tokens);
+	tokens = expand_tokens(&nr_tokens, tokens);
+
+	record_phase(PHASE_PARSE, __parse_started, instrument_now());
+
+	if (!tokens) {
+		fprintf(stderr, "Unable to expand variables\n");
+	} else if (nr_tokens) {
+		ret = __run_line(nr_tokens, tokens);
+	}
+
+	/* Utilities write to the buffered stdout */
+	fflush(stdout);
+	notify_jobs();
+
+	__parse_started = instrument_now();
+	return ret;
+}
+
+/***********************************************************************
+ * run_script()
+ *
+ * DESCRIPTION
+ *   Compile @filename as a whole (see script.h) and run the instructions.
+ *   External commands are launched directly as many times as their "for"
+ *   prefixes say, and the others go through __run_line().
+ *
+ * RETURN VALUE
+ *   Return 0 on success, -errno if @filename cannot be compiled
+ */
+static int run_script(const char *filename)
 {
-	if(sig == SIGALRM)
-	{
-		fprintf(stderr, "%s is timed out\n", name);
-		kill(pid, SIGKILL);
+	struct script script;
+	int ret;
+
+	if ((ret = compile_script(filename, &script))) {
+		fprintf(stderr, "mysh: %s: %s\n", filename, strerror(-ret));
+		return ret;
 	}
+
+	for (size_t i = 0; i < script.nr_instructions; i++) {
+		struct instruction *in = script.instructions + i;
+
+		if (in->expand) {
+			int nr_tokens = in->nr_tokens;
+			char **argv = expand_tokens(&nr_tokens, in->argv);
+
+			if (!argv) {
+				ret = -ENOMEM;
+			} else {
+				ret = nr_tokens ? __run_line(nr_tokens, argv) : 1;
+			}
+		} else if (in->op == KW_NONE) {
+			for (unsigned int n = 0; n < in->count; n++) {
+				if (__run_external(in->argv, NULL, NULL) < 0 && in->count > 1)
+					break;
+			}
+			ret = 1;
+		} else {
+			ret = __run_line(in->nr_tokens, in->argv);
+		}
+
+		if (ret == 0) {
+			break;
+		} else if (ret < 0) {
+			fprintf(stderr, "Error in run_command: %d\n", ret);
+		}
+		fflush(stdout);
+		notify_jobs();
+	}
+
+	free_script(&script);
+
+	return 0;
 }
+
 /***********************************************************************
  * initialize()
  *
@@ -202,8 +478,48 @@ static void sig_handler(int sig)
  *   Return 0 on successful initialization.
  *   Return other value on error, which leads the program to exit.
  */
+static void finalize(int argc, char * const argv[]);
+
 static int initialize(int argc, char * const argv[])
 {
+	const char *nr_launches = getenv("MYSH_BENCH_LAUNCH");
+	int ret;
+
+	/* MYSH_BENCH_LAUNCH=N ./mysh [command ...] measures launching instead */
+	if (nr_launches && atoi(nr_launches) > 0) {
+		char * const true_argv[] = { "true", NULL };
+
+		ret = benchmark_launch(atoi(nr_launches),
+				optind < argc ? argv + optind : true_argv);
+		exit(ret ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+
+	if (getenv("MYSH_PROFILE")) enable_instrument();
+	__use_zygote = getenv("MYSH_ZYGOTE") != NULL;
+
+	ret = init_reaper();
+	if (!ret) ret = init_dircache();
+	if (!ret) ret = init_env();
+	if (!ret) ret = init_history();
+	if (ret) return ret;
+
+	/* Launching without the zygote works as well */
+	if (__use_zygote && (ret = init_zygote())) {
+		fprintf(stderr, "Unable to start the zygote: %s\n", strerror(-ret));
+	}
+
+	/* ./mysh script runs the script instead of the commands from stdin */
+	if (optind < argc) {
+		ret = run_script(argv[optind]);
+		finalize(argc, argv);
+		exit(ret ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+
+	/* Background children are timed out while waiting for commands as well */
+	init_command_stream(&__commands, STDIN_FILENO);
+	__commands.wait = __wait_command;
+	__parse_started = instrument_now();
+
 	return 0;
 }
 
@@ -217,7 +533,16 @@ static int initialize(int argc, char * const argv[])
  */
 static void finalize(int argc, char * const argv[])
 {
-
+	fini_jobs();
+	fini_zygote();
+	fini_reaper();
+	fini_dircache();
+	fini_env();
+	fini_wildcards();
+	fini_history();
+	free_command_stream(&__commands);
+
+	if (instrumenting()) report_phases(stderr);
 }
 
 
@@ -233,7 +558,6 @@ static char *__color_end = "[0m";
  */
 int main(int argc, char * const argv[])
 {
-	char command[MAX_COMMAND_LEN] = { '\0' };
 	int ret = 0;
 	int opt;
 
@@ -253,11 +577,11 @@ int main(int argc, char * const argv[])
 	if (__verbose)
 		fprintf(stderr, "%s%s%s ", __color_start, __prompt, __color_end);
 
-	while (fgets(command, sizeof(command), stdin)) {	
-		char *tokens[MAX_NR_TOKENS] = { NULL };
-		int nr_tokens = 0;
+	while (read_command(&__commands) > 0) {
+		int nr_tokens = __commands.tv.nr_tokens;
+		char **tokens = __commands.tv.tokens;
 
-		if (parse_command(command, &nr_tokens, tokens) == 0)
+		if (nr_tokens == 0)
 			goto more; /* You may use nested if-than-else, however .. */
 
 		ret = run_command(nr_tokens, tokens);
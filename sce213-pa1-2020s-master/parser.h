@@ -16,6 +16,10 @@
 #ifndef __PARSER_H__
 #define __PARSER_H__
 
+#include <sys/types.h>
+
+#include "types.h"
+
 #define MAX_NR_TOKENS	32	/* Maximum length of tokens in a command */
 #define MAX_TOKEN_LEN	128	/* Maximum length of single token */
 #define MAX_COMMAND_LEN	4096 /* Maximum length of assembly string */
@@ -39,12 +43,168 @@
  *    tokens[3] = "/path/to/dest"
  *    tokens[>=4] = NULL
  *
+ *  At most MAX_NR_TOKENS tokens fit into @tokens[], and @tokens[] is not
+ *  terminated with NULL when it is full. Use parse_command_vector() for
+ *  commands that may have more tokens.
  *
  * RETURN VALUE
  *  Return 1 if @nr_tokens > 0
  *  Return 0 otherwise
+ *  Return -ENOSPC if @command has more tokens than @tokens[] can hold
  *
  */
 int parse_command(char *command, int *nr_tokens, char *tokens[]);
 
+
+/**
+ * Growable array of command tokens. Its storage is kept and reused for the
+ * following commands, so parsing a command does not allocate memory unless the
+ * command has more tokens than any command parsed with the vector before.
+ * Initialize it with zeros.
+ */
+struct token_vector {
+	char **tokens;		/* Terminated with NULL */
+	int nr_tokens;
+	int capacity;
+
+	bool __fixed;		/* @tokens is not allocated by the parser */
+};
+
+
+/***********************************************************************
+ * parse_command_vector()
+ *
+ * DESCRIPTION
+ *  Parse @command in the same way as parse_command() does, but put the tokens
+ *  into @tv, which is grown to hold all the tokens of @command. The tokens
+ *  of the previous command in @tv are discarded.
+ *
+ * RETURN VALUE
+ *  Return 1 if @tv->nr_tokens > 0
+ *  Return 0 otherwise
+ *  Return -ENOMEM if @tv cannot be grown
+ *
+ */
+int parse_command_vector(char *command, struct token_vector *tv);
+
+
+/**
+ * Tokenizer over a stream of commands such as stdin. Bytes are read() in
+ * chunks and each byte is tokenized once as it arrives; the state of the
+ * command being tokenized is kept across the chunks, so a command may be of
+ * any length and may arrive in any number of pieces.
+ */
+struct command_stream {
+	int fd;
+	struct token_vector tv;	/* Tokens of the last command */
+
+	char *buffer;
+	size_t capacity;
+	size_t begin;		/* Start of the command being tokenized */
+	size_t cursor;		/* Next byte to tokenize */
+	size_t end;		/* End of the bytes read so far */
+
+	bool in_token;
+	bool in_comment;
+	bool eof;
+
+	int (*wait)(int fd);	/* Called before blocking on @fd if set */
+};
+
+
+/***********************************************************************
+ * init_command_stream()
+ * read_command()
+ * free_command_stream()
+ *
+ * DESCRIPTION
+ *  read_command() reads @cs->fd until a complete command line (or the end of
+ *  the stream) is seen, and puts its tokens into @cs->tv in the same way as
+ *  parse_command_vector() does. The tokens stay valid until the next call.
+ *  Blank lines are returned as commands without any token. If @cs->wait is
+ *  set, it is called to wait until @cs->fd is readable before each read(),
+ *  and read_command() fails with its return value if not 0.
+ *
+ * RETURN VALUE
+ *  read_command() returns 1 if a command is read
+ *  Return 0 at the end of the stream
+ *  Return -errno on error
+ *
+ */
+void init_command_stream(struct command_stream *cs, int fd);
+int read_command(struct command_stream *cs);
+void free_command_stream(struct command_stream *cs);
+
+
+/**
+ * Token index of an entire file. The file is mapped read-only and the tokens
+ * are not terminated with '\0'; use @token_len[] to get the extent of each
+ * token. Tokens of line @l are in [@line_start[l], @line_start[l + 1]).
+ */
+struct parsed_file {
+	const char *data;	/* The file contents followed by '\0' */
+	size_t size;		/* Size of the file */
+	size_t map_size;
+
+	size_t nr_lines;
+	size_t nr_tokens;
+
+	size_t *line_start;	/* Index of the first token of each line */
+	size_t *token_offset;	/* Offset of each token in @data */
+	unsigned int *token_len;/* Length of each token */
+
+	size_t __lines_capacity;
+	size_t __tokens_capacity;
+};
+
+static inline const char *parsed_token(const struct parsed_file *pf, size_t i)
+{
+	return pf->data + pf->token_offset[i];
+}
+
+
+/***********************************************************************
+ * parse_file()
+ * parse_fd()
+ *
+ * DESCRIPTION
+ *  Map @filename (or the regular file opened as @fd) into memory and tokenize
+ *  the whole file into @pf in one pass. Each line is tokenized in the same way
+ *  as parse_command() does, but there is no limit on the length of lines nor
+ *  on the number of tokens. Release @pf with free_parsed_file().
+ *
+ *  Large files are split into chunks at line boundaries and the chunks are
+ *  tokenized in parallel, one thread per processor. parse_fd_parallel() uses
+ *  @nr_threads threads instead, or picks the number as parse_fd() does if
+ *  @nr_threads <= 0.
+ *
+ * RETURN VALUE
+ *  Return 0 on success
+ *  Return -errno otherwise. -EINVAL if @fd is not a regular file.
+ *
+ */
+int parse_file(const char *filename, struct parsed_file *pf);
+int parse_fd(int fd, struct parsed_file *pf);
+int parse_fd_parallel(int fd, struct parsed_file *pf, int nr_threads);
+void free_parsed_file(struct parsed_file *pf);
+
+
+/***********************************************************************
+ * parser_select()
+ * parser_selected()
+ *
+ * DESCRIPTION
+ *  Make the tokenizer classify characters with @impl, which is one of
+ *  "scalar", "sse2", and "avx2". The fastest one supported by the processor
+ *  is selected at startup; this is mostly for benchmarking and testing.
+ *  parser_selected() returns the name of the one in use.
+ *
+ * RETURN VALUE
+ *  Return 0 on success
+ *  Return -EINVAL if @impl is unknown or is not supported by the processor.
+ *
+ */
+int parser_select(const char *impl);
+const char *parser_selected(void);
+
 #endif
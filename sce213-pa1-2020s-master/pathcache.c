@@ -0,0 +1,226 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "types.h"
+#include "pathcache.h"
+
+#define NR_PATH_BUCKETS	256	/* Must be a power of 2 */
+
+struct path_entry {
+	struct path_entry *next;
+	unsigned long hits;
+	char *path;
+	char name[];
+};
+
+static struct path_entry *__buckets[NR_PATH_BUCKETS] = { NULL };
+static int __nr_entries = 0;
+
+/* $PATH the cached entries are looked up from */
+static char *__path_env = NULL;
+
+/* FNV-1a */
+static unsigned int __hash(const char *name)
+{
+	uint32_t hash = 2166136261u;
+
+	for (; *name; name++) {
+		hash = (hash ^ (unsigned char)*name) * 16777619u;
+	}
+	return hash & (NR_PATH_BUCKETS - 1);
+}
+
+void clear_path_cache(void)
+{
+	for (int i = 0; i < NR_PATH_BUCKETS; i++) {
+		struct path_entry *e = __buckets[i];
+
+		while (e) {
+			struct path_entry *next = e->next;
+
+			free(e->path);
+			free(e);
+			e = next;
+		}
+		__buckets[i] = NULL;
+	}
+	__nr_entries = 0;
+}
+
+void forget_command(const char *name)
+{
+	struct path_entry **pe = &__buckets[__hash(name)];
+
+	for (; *pe; pe = &(*pe)->next) {
+		struct path_entry *e = *pe;
+
+		if (strcmp(e->name, name) == 0) {
+			*pe = e->next;
+			free(e->path);
+			free(e);
+			__nr_entries--;
+			return;
+		}
+	}
+}
+
+/* Drop the cache if $PATH is not the one the cache is built from */
+static const char *__check_path_env(void)
+{
+	const char *path = getenv("PATH");
+	static char default_path[] = "/bin:/usr/bin";
+
+	if (!path) path = default_path;
+
+	if (!__path_env || strcmp(__path_env, path)) {
+		clear_path_cache();
+		free(__path_env);
+		__path_env = strdup(path);
+	}
+	return path;
+}
+
+/**
+ * Walk @path for @name. Return the allocated path of the executable, and set
+ * @cacheable if it is found in an absolute directory.
+ */
+static char *__search_path(const char *path, const char *name, bool *cacheable)
+{
+	size_t len = strlen(name);
+
+	while (true) {
+		const char *colon = strchrnul(path, ':');
+		size_t dirlen = colon - path;
+		char *candidate = malloc(dirlen + 1 + len + 1);
+		struct stat st;
+
+		if (!candidate) return NULL;
+
+		/* An empty entry means the current directory */
+		if (dirlen) {
+			memcpy(candidate, path, dirlen);
+			candidate[dirlen] = '/';
+			strcpy(candidate + dirlen + 1, name);
+		} else {
+			strcpy(candidate, name);
+		}
+
+		if (stat(candidate, &st) == 0 && S_ISREG(st.st_mode) &&
+				access(candidate, X_OK) == 0) {
+			*cacheable = dirlen && path[0] == '/';
+			return candidate;
+		}
+		free(candidate);
+
+		if (*colon == '\0') break;
+		path = colon + 1;
+	}
+
+	return NULL;
+}
+
+static struct path_entry *__lookup(const char *name, bool *found)
+{
+	const char *path_env = __check_path_env();
+	unsigned int bucket = __hash(name);
+	struct path_entry *e;
+	bool cacheable = false;
+	char *path;
+
+	for (e = __buckets[bucket]; e; e = e->next) {
+		if (strcmp(e->name, name) == 0) {
+			*found = true;
+			return e;
+		}
+	}
+
+	path = __search_path(path_env, name, &cacheable);
+	*found = !!path;
+	if (!path || !cacheable) {
+		free(path);
+		return NULL;
+	}
+
+	e = malloc(sizeof(*e) + strlen(name) + 1);
+	if (!e) {
+		free(path);
+		return NULL;
+	}
+	strcpy(e->name, name);
+	e->path = path;
+	e->hits = 0;
+	e->next = __buckets[bucket];
+	__buckets[bucket] = e;
+	__nr_entries++;
+
+	return e;
+}
+
+const char *lookup_command(const char *name)
+{
+	struct path_entry *e;
+	bool found;
+
+	if (strchr(name, '/')) return NULL;
+
+	e = __lookup(name, &found);
+	if (!e) return NULL;
+
+	e->hits++;
+	return e->path;
+}
+
+int run_hash(int nr_tokens, char * const tokens[])
+{
+	if (nr_tokens >= 2 && strcmp(tokens[1], "-r") == 0) {
+		clear_path_cache();
+		return 1;
+	}
+
+	if (nr_tokens >= 2) {
+		for (int i = 1; i < nr_tokens; i++) {
+			bool found;
+
+			if (strchr(tokens[i], '/')) continue;
+
+			__lookup(tokens[i], &found);
+			if (!found) fprintf(stderr, "hash: %s: not found\n", tokens[i]);
+		}
+		return 1;
+	}
+
+	__check_path_env();
+	if (__nr_entries == 0) {
+		fprintf(stderr, "hash: hash table empty\n");
+		return 1;
+	}
+
+	printf("hits\tcommand\n");
+	for (int i = 0; i < NR_PATH_BUCKETS; i++) {
+		for (struct path_entry *e = __buckets[i]; e; e = e->next) {
+			printf("%4lu\t%s\n", e->hits, e->path);
+		}
+	}
+	fflush(stdout);
+
+	return 1;
+}
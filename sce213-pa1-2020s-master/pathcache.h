@@ -0,0 +1,65 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#ifndef __PATHCACHE_H__
+#define __PATHCACHE_H__
+
+/***********************************************************************
+ * lookup_command()
+ *
+ * DESCRIPTION
+ *  Find the executable for @name in the directories in $PATH as execvp()
+ *  does, and remember it so that following lookups for @name do not walk
+ *  $PATH again. The cache is dropped whenever $PATH is changed.
+ *
+ *  Names containing '/' are not looked up, and executables found in relative
+ *  directories of $PATH are not cached since they depend on the current
+ *  working directory.
+ *
+ * RETURN VALUE
+ *  Return the path of the executable, which is valid until the cache is
+ *  changed. Return NULL if @name is not to be or cannot be cached.
+ *
+ */
+const char *lookup_command(const char *name);
+
+/***********************************************************************
+ * forget_command()
+ * clear_path_cache()
+ *
+ * DESCRIPTION
+ *  Drop @name, or every command, from the cache. Call forget_command() when
+ *  the executable returned by lookup_command() turns out to be gone.
+ *
+ */
+void forget_command(const char *name);
+void clear_path_cache(void);
+
+/***********************************************************************
+ * run_hash()
+ *
+ * DESCRIPTION
+ *  The hash built-in command:
+ *   hash           : List the cached commands with the number of hits
+ *   hash -r        : Clear the cache
+ *   hash name ...  : Look up and cache the commands
+ *
+ * RETURN VALUE
+ *  Return 1 as run_command() does
+ *
+ */
+int run_hash(int nr_tokens, char * const tokens[]);
+
+#endif
@@ -0,0 +1,211 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "types.h"
+#include "keywords.h"
+#include "launch.h"
+#include "launchopt.h"
+#include "pfor.h"
+#include "reaper.h"
+
+struct pfor_run {
+	pid_t pid;		/* < 0 if it could not be launched */
+	int status;
+	bool timed_out;
+	double started;
+	double elapsed;
+};
+
+static double __now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void __print_usage(void)
+{
+	fprintf(stderr, "Usage: pfor N [-j J] command ...\n");
+}
+
+static void __print_status(int index, const struct pfor_run *run)
+{
+	fprintf(stderr, "  #%-4d ", index);
+
+	if (run->pid < 0) {
+		fprintf(stderr, "unable to launch: %s\n", strerror(-run->pid));
+	} else if (WIFSIGNALED(run->status)) {
+		fprintf(stderr, "pid %-6d killed by signal %d in %.3f s%s\n",
+				run->pid, WTERMSIG(run->status), run->elapsed,
+				run->timed_out ? " (timed out)" : "");
+	} else {
+		fprintf(stderr, "pid %-6d exited with %d in %.3f s\n",
+				run->pid, WEXITSTATUS(run->status), run->elapsed);
+	}
+}
+
+static void __summarize(struct pfor_run *runs, int nr_runs, int nr_jobs,
+		double elapsed)
+{
+	int slowest = -1;
+
+	fprintf(stderr, "pfor: %d run%s in %.3f s with up to %d at once\n",
+			nr_runs, nr_runs >= 2 ? "s" : "", elapsed, nr_jobs);
+
+	for (int i = 0; i < nr_runs; i++) {
+		__print_status(i, runs + i);
+
+		if (runs[i].pid < 0) continue;
+		if (slowest < 0 || runs[i].elapsed > runs[slowest].elapsed) {
+			slowest = i;
+		}
+	}
+
+	if (slowest >= 0) {
+		fprintf(stderr, "  slowest: #%d pid %d in %.3f s\n", slowest,
+				runs[slowest].pid, runs[slowest].elapsed);
+	}
+}
+
+int run_pfor(int nr_tokens, char * const tokens[], unsigned int timeout)
+{
+	long nr_runs = 1;
+	int nr_jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	int i = 0;
+	int nr_running = 0;
+	int next = 0;
+	struct pfor_run *runs;
+	struct launch_options options;
+	char * const *argv;
+	int skip;
+	double started;
+
+	/* Multiply the counts of the for and pfor prefixes */
+	while (i < nr_tokens) {
+		enum keyword keyword = keyword_lookup(tokens[i], strlen(tokens[i]));
+
+		if (i + 1 >= nr_tokens) break;
+
+		if (keyword == KW_FOR || keyword == KW_PFOR) {
+			long n = atol(tokens[i + 1]);
+
+			/* Stop before the product passes INT32_MAX, let alone LONG_MAX */
+			if (n < 0 || (n && nr_runs > INT32_MAX / n)) {
+				__print_usage();
+				return 1;
+			}
+			nr_runs *= n;
+		} else if (strcmp(tokens[i], "-j") == 0) {
+			nr_jobs = atoi(tokens[i + 1]);
+		} else {
+			break;
+		}
+		i += 2;
+	}
+
+	if (i >= nr_tokens || nr_runs < 0 || nr_runs > INT32_MAX || nr_jobs <= 0) {
+		__print_usage();
+		return 1;
+	}
+
+	/* pin, nice and limit apply to each run */
+	if ((skip = parse_launch_options(nr_tokens - i, tokens + i, &options)) < 0)
+		return 1;
+	argv = tokens + i + skip;
+
+	if (keyword_lookup(argv[0], strlen(argv[0])) != KW_NONE) {
+		fprintf(stderr, "pfor: %s is a built-in command\n", argv[0]);
+		return 1;
+	}
+	if (nr_runs == 0) return 1;
+	if (nr_jobs > nr_runs) nr_jobs = nr_runs;
+
+	runs = calloc(nr_runs, sizeof(*runs));
+	if (!runs) {
+		fprintf(stderr, "pfor: %s\n", strerror(ENOMEM));
+		return 1;
+	}
+
+	started = __now();
+
+	while (next < nr_runs || nr_running) {
+		struct child *child;
+		struct pfor_run *run;
+		int r;
+
+		/* Keep up to nr_jobs children running */
+		while (next < nr_runs && nr_running < nr_jobs) {
+			run = runs + next;
+
+			run->started = __now();
+			if (skip) {
+				run->pid = launch_command(argv, apply_launch_options, &options);
+				launched_with_options(&options);
+			} else {
+				run->pid = launch_command(argv, NULL, NULL);
+			}
+			if (run->pid > 0) {
+				struct child *child;
+
+				child = watch_child(run->pid, argv[0], timeout);
+				if (child) {
+					child->owner = runs;
+					nr_running++;
+				} else {
+					waitpid(run->pid, &run->status, 0);
+					run->elapsed = __now() - run->started;
+				}
+			}
+			next++;
+		}
+		if (!nr_running) continue;
+
+		child = wait_any_child(runs);
+		if (!child) break;
+
+		/* Runs are launched in order, so the latest one with the pid */
+		for (r = next - 1; r >= 0 && runs[r].pid != child->pid; r--);
+		if (r < 0) {
+			release_child(child);
+			nr_running--;
+			continue;
+		}
+
+		run = runs + r;
+		run->status = child->status;
+		run->timed_out = child->timed_out;
+		run->elapsed = __now() - run->started;
+		release_child(child);
+		nr_running--;
+	}
+
+	__summarize(runs, nr_runs, nr_jobs, __now() - started);
+
+	free(runs);
+
+	return 1;
+}
@@ -0,0 +1,42 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __PFOR_H__
+#define __PFOR_H__
+
+/***********************************************************************
+ * run_pfor()
+ *
+ * DESCRIPTION
+ *  The pfor built-in command:
+ *   pfor N [-j J] command ...
+ *
+ *  Run the command N times, keeping up to J (the number of processors by
+ *  default) of them running at once. Like for, the counts of nested for and
+ *  pfor prefixes are multiplied, e.g., "for 2 pfor 3 -j 4 ./toy" runs ./toy
+ *  six times. The command may be prefixed with pin, nice and limit as well
+ *  (see launchopt.h), e.g., "pfor 8 pin -r 0-3 cmd" spreads the runs over
+ *  CPUs 0 to 3. When all runs are finished, the wall time, the exit status of
+ *  each run, and the slowest run are reported. Each run is killed when it runs
+ *  longer than @timeout seconds unless @timeout is 0.
+ *
+ * RETURN VALUE
+ *  Return 1 as run_command() does
+ *
+ */
+int run_pfor(int nr_tokens, char * const tokens[], unsigned int timeout);
+
+#endif
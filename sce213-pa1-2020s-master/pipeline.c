@@ -0,0 +1,401 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/sendfile.h>
+
+#include "types.h"
+#include "keywords.h"
+#include "launch.h"
+#include "reaper.h"
+#include "map.h"
+#include "redirect.h"
+#include "pipeline.h"
+
+/**
+ * A stage run by the shell, relaying @in to @out (and @file if any) in its
+ * own thread so that the reaper keeps timing the other stages meanwhile.
+ */
+struct relay {
+	int in;
+	int out;
+	int file;
+	pthread_t thread;
+};
+
+/* Write @len bytes in @buffer to @fd */
+static int __write_all(int fd, const char *buffer, size_t len)
+{
+	while (len) {
+		ssize_t written = write(fd, buffer, len);
+
+		if (written < 0) {
+			if (errno == EINTR) continue;
+			return -errno;
+		}
+		buffer += written;
+		len -= written;
+	}
+	return 0;
+}
+
+/* Consume @len bytes from @in into @file */
+static int __drain(struct relay *r, size_t len, bool *zero_copy)
+{
+	char buffer[4096];
+
+	while (len && *zero_copy) {
+		ssize_t moved = splice(r->in, NULL, r->file, NULL, len, SPLICE_F_MOVE);
+
+		if (moved < 0) {
+			if (errno == EINTR) continue;
+			if (errno != EINVAL) return -errno;
+			*zero_copy = false;
+			break;
+		}
+		len -= moved;
+	}
+
+	while (len) {
+		ssize_t nr_read = read(r->in, buffer,
+				len < sizeof(buffer) ? len : sizeof(buffer));
+		int ret;
+
+		if (nr_read <= 0) return nr_read ? -errno : -EPIPE;
+		if ((ret = __write_all(r->file, buffer, nr_read))) return ret;
+		len -= nr_read;
+	}
+	return 0;
+}
+
+/**
+ * Copy up to @len bytes at @offset of @in to @out in the kernel, leaving the
+ * file offset of @in alone. Return the number of bytes copied, 0 at the end
+ * of @in, or -errno.
+ */
+static ssize_t __copy_range(int in, loff_t *offset, int out, size_t len)
+{
+	ssize_t copied;
+
+	/* Between regular files; may even share the extents */
+	copied = copy_file_range(in, offset, out, NULL, len, 0);
+	if (copied >= 0) return copied;
+	if (errno != EXDEV && errno != EINVAL && errno != EOPNOTSUPP &&
+			errno != EBADF) return -errno;
+
+	/* From a regular file to anything */
+	copied = sendfile(out, in, offset, len);
+	return copied >= 0 ? copied : -errno;
+}
+
+/**
+ * Relay a regular file @r->in without bringing the data to the user space.
+ * Return false if the kernel cannot copy it so that the caller copies it.
+ */
+static bool __relay_file(struct relay *r)
+{
+	loff_t offset = lseek(r->in, 0, SEEK_CUR);
+	bool copied = false;
+
+	if (offset < 0) return false;
+
+	while (true) {
+		loff_t at = offset;
+		ssize_t len = __copy_range(r->in, &at, r->out, PIPELINE_PIPE_SIZE);
+
+		if (len == -EINTR) continue;
+		if (len < 0 && !copied) return false;
+		if (len <= 0) break;
+		copied = true;
+
+		/* Copy the same range into @file */
+		for (loff_t from = offset; r->file >= 0 && from < at; ) {
+			ssize_t ret = __copy_range(r->in, &from, r->file, at - from);
+
+			if (ret == -EINTR) continue;
+			if (ret <= 0) {
+				close(r->file);
+				r->file = -1;
+			}
+		}
+		offset = at;
+	}
+
+	lseek(r->in, offset, SEEK_SET);
+	return true;
+}
+
+/* Fall back to copying when either end is not a pipe */
+static void __relay_copy(struct relay *r)
+{
+	static __thread char buffer[64 << 10];
+	ssize_t nr_read;
+
+	if (__relay_file(r)) return;
+
+	while ((nr_read = read(r->in, buffer, sizeof(buffer))) != 0) {
+		if (nr_read < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		if (__write_all(r->out, buffer, nr_read)) break;
+		if (r->file >= 0 && __write_all(r->file, buffer, nr_read)) break;
+	}
+}
+
+static void *__relay(void *arg)
+{
+	struct relay *r = arg;
+	bool file_zero_copy = true;
+	sigset_t sigpipe;
+
+	/* Get EPIPE instead of being killed when the next stage is gone */
+	sigemptyset(&sigpipe);
+	sigaddset(&sigpipe, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &sigpipe, NULL);
+
+	while (true) {
+		ssize_t len;
+
+		if (r->file < 0) {
+			len = splice(r->in, NULL, r->out, NULL,
+					PIPELINE_PIPE_SIZE, SPLICE_F_MOVE);
+		} else {
+			/* Duplicate the data to @out, and then move them to @file */
+			len = tee(r->in, r->out, PIPELINE_PIPE_SIZE, 0);
+		}
+
+		if (len < 0 && errno == EINTR) continue;
+		if (len < 0 && errno == EINVAL) {
+			__relay_copy(r);
+			break;
+		}
+		if (len <= 0) break;
+
+		if (r->file >= 0 && __drain(r, len, &file_zero_copy)) break;
+	}
+
+	close(r->in);
+	close(r->out);
+	if (r->file >= 0) close(r->file);
+
+	return NULL;
+}
+
+/* Take @fd over from the pipeline. Standard ones are duplicated instead */
+static int __take_fd(int *fd)
+{
+	int taken = *fd;
+
+	if (taken <= STDERR_FILENO) return fcntl(taken, F_DUPFD_CLOEXEC, 0);
+
+	*fd = -1;
+	return taken;
+}
+
+int run_pipeline(int nr_tokens, char *tokens[], unsigned int timeout)
+{
+	int nr_stages = 1;
+	int (*pipes)[2] = NULL;
+	char ***stages = NULL;
+	struct child **children = NULL;
+	struct relay *relays = NULL;
+	struct redirections *files = NULL;
+	int nr_relays = 0;
+	int map_in = -1;
+
+	for (int i = 0; i < nr_tokens; i++) {
+		if (keyword_lookup(tokens[i], strlen(tokens[i])) == KW_PIPE) nr_stages++;
+	}
+
+	stages = calloc(nr_stages, sizeof(*stages));
+	pipes = calloc(nr_stages, sizeof(*pipes));
+	children = calloc(nr_stages, sizeof(*children));
+	relays = calloc(nr_stages, sizeof(*relays));
+	files = calloc(nr_stages, sizeof(*files));
+	if (!stages || !pipes || !children || !relays || !files) {
+		fprintf(stderr, "mysh: %s\n", strerror(ENOMEM));
+		goto out_free;
+	}
+
+	/* Cut the command into stages */
+	stages[0] = tokens;
+	for (int i = 0, s = 1; i < nr_tokens; i++) {
+		if (keyword_lookup(tokens[i], strlen(tokens[i])) != KW_PIPE) continue;
+
+		tokens[i] = NULL;
+		stages[s++] = tokens + i + 1;
+	}
+	for (int s = 0; s < nr_stages; s++) {
+		enum keyword keyword;
+		int nr_argv = 0;
+
+		while (stages[s][nr_argv]) nr_argv++;
+
+		/* map takes {} and the like as they are */
+		if (nr_argv && keyword_lookup(stages[s][0],
+					strlen(stages[s][0])) != KW_MAP) {
+			if (open_redirections(&nr_argv, stages[s], files + s))
+				goto out_free;
+		}
+
+		if (!stages[s][0]) {
+			fprintf(stderr, "mysh: syntax error near |\n");
+			goto out_free;
+		}
+		keyword = keyword_lookup(stages[s][0], strlen(stages[s][0]));
+		if (keyword == KW_MAP && s != nr_stages - 1) {
+			fprintf(stderr, "mysh: map should be the last stage\n");
+			goto out_free;
+		}
+		if (keyword != KW_NONE && keyword != KW_TEE && keyword != KW_MAP) {
+			fprintf(stderr, "mysh: %s cannot be used in a pipeline\n",
+					stages[s][0]);
+			goto out_free;
+		}
+	}
+
+	for (int s = 0; s < nr_stages; s++) {
+		pipes[s][0] = pipes[s][1] = -1;
+	}
+	for (int s = 0; s < nr_stages - 1; s++) {
+		if (pipe2(pipes[s], O_CLOEXEC)) {
+			fprintf(stderr, "mysh: %s\n", strerror(errno));
+			goto out_close;
+		}
+		/* Larger pipes mean fewer context switches between the stages */
+		fcntl(pipes[s][1], F_SETPIPE_SZ, PIPELINE_PIPE_SIZE);
+	}
+
+	for (int s = 0; s < nr_stages; s++) {
+		char **argv = stages[s];
+		int *in = s ? &pipes[s - 1][0] : &(int){ STDIN_FILENO };
+		int *out = s < nr_stages - 1 ? &pipes[s][1] : &(int){ STDOUT_FILENO };
+		enum keyword keyword = keyword_lookup(argv[0], strlen(argv[0]));
+
+		if (keyword == KW_MAP) {
+			/* Run by the shell once the other stages are started */
+			map_in = __take_fd(in);
+		} else if (keyword == KW_TEE) {
+			struct relay *r = relays + nr_relays;
+
+			r->file = -1;
+			if (argv[1]) {
+				r->file = open(argv[1], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+				if (r->file < 0) {
+					fprintf(stderr, "tee: %s: %s\n", argv[1], strerror(errno));
+				}
+			}
+			r->in = __take_fd(in);
+			r->out = __take_fd(out);
+
+			/* The shell is the stage, so redirect the relay */
+			for (int i = 0; i < files[s].nr; i++) {
+				struct redirection *f = files[s].r + i;
+				int *end = f->fd == STDIN_FILENO ? &r->in :
+						f->fd == STDOUT_FILENO ? &r->out : NULL;
+
+				if (!end) continue;
+				close(*end);
+				*end = fcntl(f->target, F_DUPFD_CLOEXEC, 0);
+			}
+
+			if (pthread_create(&r->thread, NULL, __relay, r)) {
+				close(r->in);
+				close(r->out);
+				if (r->file >= 0) close(r->file);
+				continue;
+			}
+			nr_relays++;
+		} else {
+			struct redirection redirections[2 + REDIRECT_MAX] = {
+				{ STDIN_FILENO, *in },
+				{ STDOUT_FILENO, *out },
+			};
+			pid_t pid;
+
+			/* Those of the stage come later to override the pipes */
+			if (rebase_redirections(files + s, STDIN_FILENO, *in) ||
+					rebase_redirections(files + s, STDOUT_FILENO, *out)) {
+				fprintf(stderr, "mysh: %s\n", strerror(errno));
+				continue;
+			}
+			memcpy(redirections + 2, files[s].r,
+					sizeof(*files[s].r) * files[s].nr);
+			pid = launch_command_redirected(argv, redirections,
+					2 + files[s].nr, NULL, NULL);
+
+			/* They may hold the pipes, which should be left to the stages */
+			close_redirections(files + s);
+
+			if (pid < 0) {
+				fprintf(stderr, "No such file or directory\n");
+				continue;
+			}
+
+			children[s] = watch_child(pid, argv[0], timeout);
+			if (!children[s]) waitpid(pid, NULL, 0);
+		}
+	}
+
+out_close:
+	/* Leave the pipes to the stages so that they see EOF or EPIPE */
+	for (int s = 0; s < nr_stages - 1; s++) {
+		if (pipes[s][0] >= 0) close(pipes[s][0]);
+		if (pipes[s][1] >= 0) close(pipes[s][1]);
+	}
+
+	if (map_in >= 0) {
+		char **argv = stages[nr_stages - 1];
+		int nr_argv = 0;
+
+		while (argv[nr_argv]) nr_argv++;
+
+		run_map(nr_argv, argv, map_in, timeout);
+		close(map_in);
+	}
+
+	for (int s = 0; s < nr_stages; s++) {
+		if (!children[s]) continue;
+
+		wait_child(children[s]);
+		release_child(children[s]);
+	}
+	for (int i = 0; i < nr_relays; i++) {
+		pthread_join(relays[i].thread, NULL);
+	}
+
+out_free:
+	for (int s = 0; files && s < nr_stages; s++) {
+		close_redirections(files + s);
+	}
+	free(files);
+	free(relays);
+	free(children);
+	free(pipes);
+	free(stages);
+
+	return 1;
+}
@@ -0,0 +1,43 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+/***********************************************************************
+ * run_pipeline()
+ *
+ * DESCRIPTION
+ *  Run the stages of "command | command | ..." at the same time with the
+ *  standard output of each stage connected to the standard input of the
+ *  next one. Each stage is killed when it runs longer than @timeout seconds
+ *  unless @timeout is 0.
+ *
+ *  The built-in "tee [file]" stage is run by the shell. It passes the data
+ *  on to the next stage and copies them into @file, moving them with tee()
+ *  and splice() without copying them through the shell. The built-in map
+ *  (see map.h) can be the last stage, and is run by the shell as well.
+ *
+ * RETURN VALUE
+ *  Return 1 as run_command() does
+ *
+ */
+int run_pipeline(int nr_tokens, char *tokens[], unsigned int timeout);
+
+/* Size of the pipes between stages */
+#define PIPELINE_PIPE_SIZE	(1 << 20)
+
+#endif
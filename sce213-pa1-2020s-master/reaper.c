@@ -0,0 +1,354 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+
+#include "types.h"
+#include "reaper.h"
+
+static int __sigchld_fd = -1;
+static sigset_t __sigmask;		/* The mask before blocking SIGCHLD */
+
+static struct child *__children = NULL;	/* Watched children */
+
+/* Resources used by the children reaped since take_rusage() */
+static struct rusage __rusage;
+
+/* Min-heap of the timed children ordered by their deadlines */
+static struct child **__heap = NULL;
+static int __nr_heap = 0;
+static int __heap_capacity = 0;
+
+static double __now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/***********************************************************************
+ * Deadline heap
+ */
+static inline void __heap_set(int i, struct child *c)
+{
+	__heap[i] = c;
+	c->__heap = i;
+}
+
+static void __sift_up(int i)
+{
+	struct child *c = __heap[i];
+
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+
+		if (__heap[parent]->deadline <= c->deadline) break;
+		__heap_set(i, __heap[parent]);
+		i = parent;
+	}
+	__heap_set(i, c);
+}
+
+static void __sift_down(int i)
+{
+	struct child *c = __heap[i];
+
+	while (true) {
+		int min = 2 * i + 1;
+
+		if (min >= __nr_heap) break;
+		if (min + 1 < __nr_heap &&
+				__heap[min + 1]->deadline < __heap[min]->deadline) {
+			min++;
+		}
+		if (c->deadline <= __heap[min]->deadline) break;
+
+		__heap_set(i, __heap[min]);
+		i = min;
+	}
+	__heap_set(i, c);
+}
+
+static int __heap_push(struct child *c)
+{
+	if (__nr_heap == __heap_capacity) {
+		int capacity = __heap_capacity ? __heap_capacity * 2 : 16;
+		struct child **heap = realloc(__heap, sizeof(*heap) * capacity);
+
+		if (!heap) return -ENOMEM;
+		__heap = heap;
+		__heap_capacity = capacity;
+	}
+
+	__heap_set(__nr_heap++, c);
+	__sift_up(c->__heap);
+	return 0;
+}
+
+static void __heap_remove(struct child *c)
+{
+	int i = c->__heap;
+	struct child *moved;
+
+	if (i < 0) return;
+	c->__heap = -1;
+
+	if (i == --__nr_heap) return;
+
+	moved = __heap[__nr_heap];
+	__heap_set(i, moved);
+	__sift_up(i);
+	__sift_down(moved->__heap);
+}
+
+
+/***********************************************************************
+ * Reaper
+ */
+int init_reaper(void)
+{
+	sigset_t sigchld;
+
+	sigemptyset(&sigchld);
+	sigaddset(&sigchld, SIGCHLD);
+
+	if (sigprocmask(SIG_BLOCK, &sigchld, &__sigmask)) return -errno;
+
+	__sigchld_fd = signalfd(-1, &sigchld, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (__sigchld_fd < 0) {
+		int ret = -errno;
+
+		sigprocmask(SIG_SETMASK, &__sigmask, NULL);
+		return ret;
+	}
+
+	return 0;
+}
+
+void fini_reaper(void)
+{
+	while (__children) release_child(__children);
+
+	free(__heap);
+	__heap = NULL;
+	__nr_heap = __heap_capacity = 0;
+
+	if (__sigchld_fd >= 0) {
+		close(__sigchld_fd);
+		__sigchld_fd = -1;
+		sigprocmask(SIG_SETMASK, &__sigmask, NULL);
+	}
+}
+
+const sigset_t *reaper_sigmask(void)
+{
+	return __sigchld_fd >= 0 ? &__sigmask : NULL;
+}
+
+struct child *watch_child(pid_t pid, const char *name, unsigned int timeout)
+{
+	struct child *c = malloc(sizeof(*c));
+
+	if (!c) return NULL;
+
+	memset(c, 0x00, sizeof(*c));
+	c->pid = pid;
+	c->name = strdup(name);
+	c->__heap = -1;
+
+	if (timeout) {
+		c->deadline = __now() + timeout;
+		if (__heap_push(c)) {
+			free(c->name);
+			free(c);
+			return NULL;
+		}
+	}
+
+	c->__next = __children;
+	__children = c;
+
+	return c;
+}
+
+void release_child(struct child *child)
+{
+	struct child **pc;
+
+	for (pc = &__children; *pc; pc = &(*pc)->__next) {
+		if (*pc == child) {
+			*pc = child->__next;
+			break;
+		}
+	}
+
+	__heap_remove(child);
+	free(child->name);
+	free(child);
+}
+
+/**
+ * Collect the exit status of the watched children that exited. Others are
+ * left alone for their waitpid() callers.
+ */
+static void __reap(void)
+{
+	struct signalfd_siginfo info;
+	struct rusage rusage;
+	int status;
+
+	/* SIGCHLDs are coalesced. Drain them, and then check all */
+	while (read(__sigchld_fd, &info, sizeof(info)) == sizeof(info));
+
+	for (struct child *c = __children; c; c = c->__next) {
+		if (c->exited) continue;
+		if (wait4(c->pid, &status, WNOHANG, &rusage) <= 0) continue;
+
+		timeradd(&__rusage.ru_utime, &rusage.ru_utime, &__rusage.ru_utime);
+		timeradd(&__rusage.ru_stime, &rusage.ru_stime, &__rusage.ru_stime);
+		if (rusage.ru_maxrss > __rusage.ru_maxrss)
+			__rusage.ru_maxrss = rusage.ru_maxrss;
+
+		c->status = status;
+		c->rusage = rusage;
+		c->reaped_at = __now();
+		c->exited = true;
+		__heap_remove(c);
+	}
+}
+
+/* Kill the children past their deadlines. Return ms to the next deadline */
+static int __expire(void)
+{
+	double now = __now();
+
+	while (__nr_heap && __heap[0]->deadline <= now) {
+		struct child *c = __heap[0];
+
+		__heap_remove(c);
+		c->timed_out = true;
+		kill(c->pid, SIGKILL);
+		fprintf(stderr, "%s is timed out\n", c->name);
+	}
+
+	if (!__nr_heap) return -1;
+
+	return (__heap[0]->deadline - now) * 1000 + 1;
+}
+
+void reap_children(void)
+{
+	if (__sigchld_fd < 0) return;
+
+	__reap();
+	__expire();
+}
+
+int wait_readable(int fd)
+{
+	struct pollfd pfds[2] = {
+		{ .fd = fd, .events = POLLIN, },
+		{ .fd = __sigchld_fd, .events = POLLIN, },
+	};
+
+	if (__sigchld_fd < 0) return 0;
+
+	while (true) {
+		int timeout_ms;
+
+		__reap();
+		timeout_ms = __expire();
+
+		if (poll(pfds, 2, timeout_ms) < 0) {
+			if (errno == EINTR) continue;
+			return -errno;
+		}
+		if (pfds[0].revents) return 0;
+	}
+}
+
+/**
+ * Find an exited child of @owner that is not returned yet. Set @none if
+ * @owner has no child to wait for.
+ */
+static struct child *__find_exited(const void *owner, bool *none)
+{
+	*none = true;
+
+	for (struct child *c = __children; c; c = c->__next) {
+		if (c->owner != owner || c->__reported) continue;
+
+		if (c->exited) {
+			c->__reported = true;
+			return c;
+		}
+		*none = false;
+	}
+	return NULL;
+}
+
+static struct child *__wait(struct child *child, const void *owner)
+{
+	struct pollfd pfd = {
+		.fd = __sigchld_fd,
+		.events = POLLIN,
+	};
+
+	while (true) {
+		int timeout_ms;
+
+		__reap();
+		timeout_ms = __expire();
+
+		if (child) {
+			if (child->exited) return child;
+		} else {
+			bool none;
+			struct child *c = __find_exited(owner, &none);
+
+			if (c) return c;
+			if (none) return NULL;
+		}
+
+		if (poll(&pfd, 1, timeout_ms) < 0 && errno != EINTR) return NULL;
+	}
+}
+
+struct child *wait_child(struct child *child)
+{
+	return __wait(child, NULL);
+}
+
+struct child *wait_any_child(const void *owner)
+{
+	return __wait(NULL, owner);
+}
+
+void take_rusage(struct rusage *usage)
+{
+	*usage = __rusage;
+	memset(&__rusage, 0x00, sizeof(__rusage));
+}
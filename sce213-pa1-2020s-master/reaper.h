@@ -0,0 +1,139 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __REAPER_H__
+#define __REAPER_H__
+
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "types.h"
+
+/**
+ * A child process watched by the reaper. SIGCHLD is received through a
+ * signalfd, and the deadlines of children are kept in a min-heap, so any
+ * number of children can be waited for and timed out independently without
+ * signal handlers.
+ */
+struct child {
+	pid_t pid;
+	char *name;
+	double deadline;	/* 0 if the child is not timed */
+
+	int status;		/* As reported by wait4() */
+	struct rusage rusage;
+	double reaped_at;	/* CLOCK_MONOTONIC seconds when reaped */
+	bool exited;
+	bool timed_out;
+
+	const void *owner;	/* Set by the caller to tell its children */
+
+	bool __reported;	/* Returned by wait_any_child() */
+	int __heap;		/* Index in the deadline heap, or -1 */
+	struct child *__next;
+};
+
+/***********************************************************************
+ * init_reaper()
+ * fini_reaper()
+ *
+ * DESCRIPTION
+ *  Block SIGCHLD and start receiving it through a signalfd. Children should
+ *  be started with the signal mask returned by reaper_sigmask() so that they
+ *  do not inherit the blocked SIGCHLD.
+ *
+ * RETURN VALUE
+ *  init_reaper() returns 0 on success, -errno otherwise
+ *
+ */
+int init_reaper(void);
+void fini_reaper(void);
+const sigset_t *reaper_sigmask(void);
+
+/***********************************************************************
+ * watch_child()
+ *
+ * DESCRIPTION
+ *  Start watching child @pid named @name. If @timeout is not 0, the child
+ *  is killed with SIGKILL when it runs longer than @timeout seconds, and
+ *  "@name is timed out" is printed.
+ *
+ * RETURN VALUE
+ *  Return the child, or NULL if out of memory
+ *
+ */
+struct child *watch_child(pid_t pid, const char *name, unsigned int timeout);
+
+/***********************************************************************
+ * wait_child()
+ * wait_any_child()
+ * release_child()
+ *
+ * DESCRIPTION
+ *  Wait until @child exits, or until any child whose @owner is @owner
+ *  exits, while reaping and timing out all children on the way. The child is
+ *  kept until release_child() is called, and is not returned by
+ *  wait_any_child() again.
+ *
+ * RETURN VALUE
+ *  Return the exited child
+ *  Return NULL if no child of @owner is left to wait for
+ *
+ */
+struct child *wait_child(struct child *child);
+struct child *wait_any_child(const void *owner);
+void release_child(struct child *child);
+
+/***********************************************************************
+ * reap_children()
+ *
+ * DESCRIPTION
+ *  Collect exited children and time out children without blocking, so that
+ *  children running in the background do not linger as zombies. Only the
+ *  watched children are collected; others are left for waitpid().
+ *
+ */
+void reap_children(void);
+
+/***********************************************************************
+ * wait_readable()
+ *
+ * DESCRIPTION
+ *  Wait until @fd is readable while reaping and timing out children, so
+ *  that children in the background are killed on time even while the shell
+ *  is waiting for its input.
+ *
+ * RETURN VALUE
+ *  Return 0 when @fd is readable, -errno on error
+ *
+ */
+int wait_readable(int fd);
+
+/***********************************************************************
+ * take_rusage()
+ *
+ * DESCRIPTION
+ *  Put into @usage the resources used by all the children reaped since the
+ *  last call, and start counting over. The user and system times are summed
+ *  up, and ru_maxrss is the largest of the children. The other fields are
+ *  zeroed.
+ *
+ */
+void take_rusage(struct rusage *usage);
+
+#endif
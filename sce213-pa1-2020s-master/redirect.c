@@ -0,0 +1,218 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "types.h"
+#include "redirect.h"
+
+static const struct {
+	const char *op;
+	int fd;
+	int flags;
+} __operators[] = {	/* Longer ones first */
+	{ ">>", STDOUT_FILENO, O_WRONLY | O_CREAT | O_APPEND },
+	{ ">", STDOUT_FILENO, O_WRONLY | O_CREAT | O_TRUNC },
+	{ "<", STDIN_FILENO, O_RDONLY },
+};
+
+static int __nr_swapped = 0;
+
+/**
+ * Parse @token as an optional stream number followed by one of __operators,
+ * and optionally by &N. Put the stream into @fd and what follows the operator
+ * into @rest. Return the index of the operator, or -1 if @token is not a
+ * redirection, such as ">x" which is an argument as it is.
+ */
+static int __operator(const char *token, int *fd, const char **rest)
+{
+	const char *op = token;
+	int stream = -1;
+
+	if (op[0] >= '0' && op[0] <= '9') stream = *op++ - '0';
+
+	for (int i = 0; i < sizeof(__operators) / sizeof(*__operators); i++) {
+		size_t len = strlen(__operators[i].op);
+
+		if (strncmp(op, __operators[i].op, len)) continue;
+		if (op[len] && op[len] != '&') return -1;
+
+		*fd = stream >= 0 ? stream : __operators[i].fd;
+		*rest = op + len;
+		return i;
+	}
+	return -1;
+}
+
+/* Stream the digit @str stands for, or -1 */
+static int __stream(const char *str)
+{
+	if (str[0] < '0' || str[0] > '9' || str[1]) return -1;
+	return str[0] - '0';
+}
+
+/* What stream @fd is after the redirections so far */
+static int __current(const struct redirections *redirections, int fd)
+{
+	for (int i = redirections->nr - 1; i >= 0; i--) {
+		if (redirections->r[i].fd == fd) return redirections->r[i].target;
+	}
+	return fd;
+}
+
+bool is_redirection(const char *token)
+{
+	const char *rest;
+	int fd;
+
+	return __operator(token, &fd, &rest) >= 0;
+}
+
+int open_redirections(int *nr_tokens, char *tokens[],
+		struct redirections *redirections)
+{
+	int nr = 0;
+
+	redirections->nr = 0;
+	redirections->swapped = false;
+
+	for (int i = 0; i < *nr_tokens; i++) {
+		const char *file;
+		struct redirection *r;
+		int fd;
+		int op = __operator(tokens[i], &fd, &file);
+
+		if (op < 0) {
+			tokens[nr++] = tokens[i];
+			continue;
+		}
+
+		/* The file follows the operator unless it is &N */
+		if (!*file) file = i + 1 < *nr_tokens ? tokens[++i] : NULL;
+		if (!file) {
+			fprintf(stderr, "mysh: syntax error near %s\n", tokens[i]);
+			close_redirections(redirections);
+			return -EINVAL;
+		}
+		if (redirections->nr == REDIRECT_MAX) {
+			fprintf(stderr, "mysh: too many redirections\n");
+			close_redirections(redirections);
+			return -E2BIG;
+		}
+
+		r = redirections->r + redirections->nr;
+		r->fd = fd;
+		redirections->from[redirections->nr] = -1;
+
+		if (file[0] == '&') {
+			int from = __stream(file + 1);
+
+			if (from < 0) {
+				fprintf(stderr, "mysh: syntax error near %s\n", file);
+				close_redirections(redirections);
+				return -EINVAL;
+			}
+			redirections->from[redirections->nr] = from;
+			r->target = fcntl(__current(redirections, from), F_DUPFD_CLOEXEC, 0);
+		} else {
+			r->target = open(file, __operators[op].flags | O_CLOEXEC, 0644);
+		}
+		if (r->target < 0) {
+			int ret = -errno;
+
+			fprintf(stderr, "mysh: %s: %s\n", file, strerror(errno));
+			close_redirections(redirections);
+			return ret;
+		}
+		redirections->nr++;
+	}
+
+	*nr_tokens = nr;
+	tokens[nr] = NULL;
+
+	return 0;
+}
+
+int rebase_redirections(struct redirections *redirections, int fd, int target)
+{
+	for (int i = 0; i < redirections->nr; i++) {
+		struct redirection *r = redirections->r + i;
+		int dup;
+
+		/* Later ones duplicate what this one opened */
+		if (r->fd == fd) break;
+
+		if (redirections->from[i] != fd) continue;
+
+		if ((dup = fcntl(target, F_DUPFD_CLOEXEC, 0)) < 0) return -errno;
+		close(r->target);
+		r->target = dup;
+	}
+	return 0;
+}
+
+void close_redirections(struct redirections *redirections)
+{
+	for (int i = 0; i < redirections->nr; i++) {
+		close(redirections->r[i].target);
+	}
+	redirections->nr = 0;
+}
+
+void swap_redirections(struct redirections *redirections)
+{
+	/* Do not let buffered output go to the other file */
+	fflush(stdout);
+	fflush(stderr);
+
+	if (!redirections->swapped) {
+		for (int i = 0; i < redirections->nr; i++) {
+			struct redirection *r = redirections->r + i;
+			int saved = fcntl(r->fd, F_DUPFD_CLOEXEC, STDERR_FILENO + 1);
+
+			dup2(r->target, r->fd);
+			close(r->target);
+			r->target = saved;	/* -1 if it was not open */
+		}
+		redirections->swapped = true;
+		__nr_swapped++;
+		return;
+	}
+
+	for (int i = redirections->nr - 1; i >= 0; i--) {
+		struct redirection *r = redirections->r + i;
+
+		if (r->target >= 0) {
+			dup2(r->target, r->fd);
+			close(r->target);
+		} else {
+			close(r->fd);
+		}
+	}
+	redirections->nr = 0;
+	redirections->swapped = false;
+	__nr_swapped--;
+}
+
+bool shell_redirected(void)
+{
+	return __nr_swapped > 0;
+}
@@ -0,0 +1,102 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __REDIRECT_H__
+#define __REDIRECT_H__
+
+#include "types.h"
+#include "launch.h"
+
+#define REDIRECT_MAX	8
+
+/**
+ * Redirections of a command line. An operator is a token of its own, and the
+ * file is the token following it:
+ *
+ *   < file     > file     >> file     N< file     N> file     N>> file
+ *
+ * where N is a single digit naming the stream, which is 0 for < and 1 for >
+ * and >> otherwise. Tokens merely starting with an operator, such as ">x",
+ * are arguments. Files are opened by the shell with O_CLOEXEC, and are made
+ * the streams of the command with dup2() in the child.
+ *
+ * &N attached to the operator, as in 2>&1, duplicates stream N as it is at
+ * that point of the command line. The stream is duplicated by the shell as
+ * well, from the file an earlier redirection gave it or from the stream of
+ * the shell otherwise. Other targets starting with & are syntax errors.
+ */
+struct redirections {
+	int nr;
+	struct redirection r[REDIRECT_MAX];
+	int from[REDIRECT_MAX];	/* Stream r[i] duplicates, or -1 for a file */
+	bool swapped;		/* Applied to the shell by swap_redirections() */
+};
+
+/***********************************************************************
+ * is_redirection()
+ *
+ * RETURN VALUE
+ *  Return true if @token is a redirection operator
+ *
+ */
+bool is_redirection(const char *token);
+
+/***********************************************************************
+ * open_redirections()
+ * close_redirections()
+ *
+ * DESCRIPTION
+ *  Open the files of the redirections in @tokens into @redirections, and
+ *  remove the redirections from @tokens and @nr_tokens. Errors are
+ *  reported to stderr.
+ *
+ * RETURN VALUE
+ *  open_redirections() returns 0 on success, -errno otherwise. Nothing is
+ *  left open on error.
+ *
+ */
+int open_redirections(int *nr_tokens, char *tokens[],
+		struct redirections *redirections);
+void close_redirections(struct redirections *redirections);
+
+/***********************************************************************
+ * rebase_redirections()
+ *
+ * DESCRIPTION
+ *  Make the duplicates of stream @fd in @redirections duplicate @target
+ *  instead of the stream of the shell, for commands whose @fd is set up
+ *  to be @target before their own redirections, such as pipeline stages.
+ *
+ * RETURN VALUE
+ *  Return 0 on success, -errno otherwise
+ *
+ */
+int rebase_redirections(struct redirections *redirections, int fd, int target);
+
+/***********************************************************************
+ * swap_redirections()
+ *
+ * DESCRIPTION
+ *  Apply @redirections to the shell itself for built-in commands, or undo
+ *  it and close the files when called again. While they are applied,
+ *  launching through the zygote passes the standard streams of the shell to
+ *  the commands.
+ *
+ */
+void swap_redirections(struct redirections *redirections);
+bool shell_redirected(void);
+
+#endif
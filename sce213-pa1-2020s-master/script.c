@@ -0,0 +1,169 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+
+#include "types.h"
+#include "parser.h"
+#include "keywords.h"
+#include "redirect.h"
+#include "wildcard.h"
+#include "script.h"
+
+static enum keyword __keyword(const char *token)
+{
+	return token ? keyword_lookup(token, strlen(token)) : KW_NONE;
+}
+
+/**
+ * Parse the N of "for N" as run_command() does; N that is not a positive
+ * number runs the command 0 times
+ */
+static unsigned int __count(const char *token)
+{
+	char *end;
+	long count;
+
+	errno = 0;
+	count = strtol(token, &end, 10);
+	if (errno || end == token || count <= 0) return 0;
+
+	return count > INT_MAX ? INT_MAX : count;
+}
+
+/* Resolve the command of @argv, and fold the "for N" prefixes if possible */
+static void __compile(struct instruction *in)
+{
+	char **argv = in->argv;
+	int nr_tokens = in->nr_tokens;
+	unsigned int count = 1;
+	int num = 0;
+	size_t len;
+
+	in->op = __keyword(argv[0]);
+
+	/* Variables and wildcards are expanded when the line is run */
+	for (int i = 0; i < nr_tokens; i++) {
+		if (strchr(argv[i], '$') || has_wildcards(argv[i])) {
+			in->expand = true;
+			return;
+		}
+	}
+
+	/* Leave pipelines, redirections and background jobs to run_command() */
+	for (int i = 0; i < nr_tokens; i++) {
+		if (__keyword(argv[i]) == KW_PIPE) {
+			in->op = KW_PIPE;
+			return;
+		}
+		if (is_redirection(argv[i])) in->op = KW_REDIRECT;
+	}
+	if (in->op == KW_REDIRECT) return;
+	len = strlen(argv[nr_tokens - 1]);
+	if (len && argv[nr_tokens - 1][len - 1] == '&') {
+		in->op = KW_BACKGROUND;
+		return;
+	}
+
+	if (in->op != KW_FOR) return;
+
+	while (__keyword(argv[num]) == KW_FOR && num + 2 < nr_tokens) {
+		unsigned int n = __count(argv[num + 1]);
+
+		/* Leave it to run_command() to complain about too many runs */
+		if (n && count > INT_MAX / n) return;
+		count *= n;
+		num += 2;
+	}
+
+	/* Only plain external commands are run directly */
+	if (__keyword(argv[num]) != KW_NONE) return;
+	for (int i = num; i < nr_tokens; i++) {
+		if (__keyword(argv[i]) == KW_FOR) return;
+	}
+
+	in->op = KW_NONE;
+	in->count = count;
+	in->argv = argv + num;
+	in->nr_tokens = nr_tokens - num;
+}
+
+int compile_script(const char *filename, struct script *script)
+{
+	struct parsed_file pf;
+	struct instruction *in;
+	char **argv;
+	char *strings;
+	int ret;
+
+	memset(script, 0x00, sizeof(*script));
+
+	if ((ret = parse_file(filename, &pf))) return ret;
+
+	script->instructions = malloc(sizeof(*in) * (pf.nr_lines + 1));
+	script->__argv = malloc(sizeof(*argv) * (pf.nr_tokens + pf.nr_lines + 1));
+	script->__strings = malloc(pf.nr_tokens + pf.size + 1);
+	if (!script->instructions || !script->__argv || !script->__strings) {
+		free_parsed_file(&pf);
+		free_script(script);
+		return -ENOMEM;
+	}
+
+	in = script->instructions;
+	argv = script->__argv;
+	strings = script->__strings;
+
+	for (size_t l = 0; l < pf.nr_lines; l++) {
+		size_t first = pf.line_start[l];
+		size_t last = pf.line_start[l + 1];
+
+		if (first == last) continue;
+
+		in->count = 1;
+		in->expand = false;
+		in->nr_tokens = last - first;
+		in->argv = argv;
+
+		for (size_t t = first; t < last; t++) {
+			memcpy(strings, parsed_token(&pf, t), pf.token_len[t]);
+			strings[pf.token_len[t]] = '\0';
+
+			*argv++ = strings;
+			strings += pf.token_len[t] + 1;
+		}
+		*argv++ = NULL;
+
+		__compile(in++);
+	}
+	script->nr_instructions = in - script->instructions;
+
+	free_parsed_file(&pf);
+
+	return 0;
+}
+
+void free_script(struct script *script)
+{
+	free(script->instructions);
+	free(script->__argv);
+	free(script->__strings);
+
+	memset(script, 0x00, sizeof(*script));
+}
@@ -0,0 +1,64 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __SCRIPT_H__
+#define __SCRIPT_H__
+
+#include <stddef.h>
+
+#include "types.h"
+#include "keywords.h"
+
+/**
+ * A command line of a script, ready to be run @count times. For external
+ * commands (@op == KW_NONE), the "for N" prefixes are folded into @count and
+ * @argv starts at the command itself. Other commands keep all their tokens
+ * in @argv and are given to run_command() as they are. Lines referring to
+ * variables or having wildcards are marked with @expand and left as they
+ * are, to be expanded right before running.
+ */
+struct instruction {
+	enum keyword op;	/* Resolved keyword of the command */
+	unsigned int count;
+	bool expand;		/* Has '$' or wildcards in its tokens */
+	int nr_tokens;
+	char **argv;		/* NULL-terminated */
+};
+
+struct script {
+	size_t nr_instructions;
+	struct instruction *instructions;
+
+	char **__argv;		/* All argv arrays */
+	char *__strings;	/* All tokens, each terminated with '\0' */
+};
+
+/***********************************************************************
+ * compile_script()
+ * free_script()
+ *
+ * DESCRIPTION
+ *  Tokenize the whole @filename at once and translate its command lines into
+ *  instructions. Blank lines are dropped. Release @script with free_script().
+ *
+ * RETURN VALUE
+ *  Return 0 on success, -errno otherwise
+ *
+ */
+int compile_script(const char *filename, struct script *script);
+void free_script(struct script *script);
+
+#endif
@@ -0,0 +1,237 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "types.h"
+#include "utility.h"
+
+static int __echo(int argc, char * const argv[])
+{
+	bool newline = true;
+	int i = 1;
+
+	if (argc > 1 && strcmp(argv[1], "-n") == 0) {
+		newline = false;
+		i++;
+	}
+
+	for (; i < argc; i++) {
+		fputs(argv[i], stdout);
+		if (i < argc - 1) putchar(' ');
+	}
+	if (newline) putchar('\n');
+
+	return 0;
+}
+
+static int __true(int argc, char * const argv[])
+{
+	return 0;
+}
+
+static int __false(int argc, char * const argv[])
+{
+	return 1;
+}
+
+static int __pwd(int argc, char * const argv[])
+{
+	char cwd[PATH_MAX];
+
+	if (!getcwd(cwd, sizeof(cwd))) {
+		fprintf(stderr, "pwd: %s\n", strerror(errno));
+		return 1;
+	}
+	puts(cwd);
+
+	return 0;
+}
+
+
+/***********************************************************************
+ * test
+ */
+static int __test_file(const char *op, const char *file)
+{
+	struct stat st;
+
+	if (!strchr("rwxefds", op[1])) return -1;
+
+	switch (op[1]) {
+	case 'r': return access(file, R_OK) == 0;
+	case 'w': return access(file, W_OK) == 0;
+	case 'x': return access(file, X_OK) == 0;
+	}
+
+	if (stat(file, &st)) return 0;
+
+	switch (op[1]) {
+	case 'e': return 1;
+	case 'f': return S_ISREG(st.st_mode);
+	case 'd': return S_ISDIR(st.st_mode);
+	case 's': return st.st_size > 0;
+	}
+	return -1;
+}
+
+static int __test_integer(const char *left, const char *op, const char *right)
+{
+	char *end_left, *end_right;
+	long l = strtol(left, &end_left, 10);
+	long r = strtol(right, &end_right, 10);
+
+	if (end_left == left || *end_left || end_right == right || *end_right) {
+		fprintf(stderr, "test: integer expression expected\n");
+		return -1;
+	}
+
+	if (strcmp(op, "-eq") == 0) return l == r;
+	if (strcmp(op, "-ne") == 0) return l != r;
+	if (strcmp(op, "-lt") == 0) return l < r;
+	if (strcmp(op, "-le") == 0) return l <= r;
+	if (strcmp(op, "-gt") == 0) return l > r;
+	if (strcmp(op, "-ge") == 0) return l >= r;
+	return -1;
+}
+
+/* Evaluate the expression in @argv. Return 1 if true, 0 if false, -1 on error */
+static int __evaluate(int argc, char * const argv[])
+{
+	switch (argc) {
+	case 0:
+		return 0;
+	case 1:
+		return argv[0][0] != '\0';
+	case 2:
+		if (strcmp(argv[0], "-z") == 0) return argv[1][0] == '\0';
+		if (strcmp(argv[0], "-n") == 0) return argv[1][0] != '\0';
+		if (argv[0][0] == '-' && argv[0][1] && !argv[0][2]) {
+			return __test_file(argv[0], argv[1]);
+		}
+		break;
+	case 3:
+		if (strcmp(argv[1], "=") == 0) return strcmp(argv[0], argv[2]) == 0;
+		if (strcmp(argv[1], "!=") == 0) return strcmp(argv[0], argv[2]) != 0;
+		if (argv[1][0] == '-') return __test_integer(argv[0], argv[1], argv[2]);
+		break;
+	}
+
+	if (strcmp(argv[0], "!") == 0) {
+		int ret = __evaluate(argc - 1, argv + 1);
+
+		return ret < 0 ? ret : !ret;
+	}
+	return -1;
+}
+
+static int __test(int argc, char * const argv[])
+{
+	int ret;
+
+	if (strcmp(argv[0], "[") == 0) {
+		if (strcmp(argv[argc - 1], "]")) {
+			fprintf(stderr, "[: missing ]\n");
+			return 2;
+		}
+		argc--;
+	}
+
+	ret = __evaluate(argc - 1, argv + 1);
+	if (ret < 0) {
+		fprintf(stderr, "%s: unsupported expression\n", argv[0]);
+		return 2;
+	}
+	return !ret;
+}
+
+
+static struct utility __utilities[] = {
+	{ "echo", __echo, true },
+	{ "true", __true, true },
+	{ "false", __false, true },
+	{ "pwd", __pwd, true },
+	{ "test", __test, true },
+	{ "[", __test, true },
+};
+
+#define NR_UTILITIES	(sizeof(__utilities) / sizeof(*__utilities))
+
+static struct utility *__find(const char *name)
+{
+	for (int i = 0; i < NR_UTILITIES; i++) {
+		if (strcmp(__utilities[i].name, name) == 0) return __utilities + i;
+	}
+	return NULL;
+}
+
+struct utility *lookup_utility(const char *name)
+{
+	struct utility *utility = __find(name);
+
+	return utility && utility->enabled ? utility : NULL;
+}
+
+int run_utility(struct utility *utility, char * const argv[])
+{
+	int argc = 0;
+
+	while (argv[argc]) argc++;
+
+	return utility->run(argc, argv);
+}
+
+int run_enable(int nr_tokens, char * const tokens[])
+{
+	bool enable = true;
+	int i = 1;
+
+	if (nr_tokens > 1 && strcmp(tokens[1], "-n") == 0) {
+		enable = false;
+		i++;
+	}
+
+	if (i == nr_tokens) {
+		for (int j = 0; j < NR_UTILITIES; j++) {
+			printf("enable %s%s\n", __utilities[j].enabled ? "" : "-n ",
+					__utilities[j].name);
+		}
+		return 1;
+	}
+
+	for (; i < nr_tokens; i++) {
+		struct utility *utility = __find(tokens[i]);
+
+		if (!utility) {
+			fprintf(stderr, "enable: %s: not a utility\n", tokens[i]);
+			continue;
+		}
+		utility->enabled = enable;
+
+		/* test and [ go together */
+		if (utility->run == __test) {
+			__find("test")->enabled = __find("[")->enabled = enable;
+		}
+	}
+	return 1;
+}
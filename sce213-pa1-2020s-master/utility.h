@@ -0,0 +1,76 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __UTILITY_H__
+#define __UTILITY_H__
+
+#include "types.h"
+
+/**
+ * Common utilities run in the shell process instead of being launched, so
+ * that "for 10000 echo x" does not create 10000 processes. They behave like
+ * their coreutils counterparts for the usual options, and write to the
+ * buffered stdout of the shell. Each of them can be disabled with "enable -n"
+ * to run the external one instead.
+ *
+ *   echo [-n] [arg ...]
+ *   true, false
+ *   pwd
+ *   test expression, [ expression ]
+ */
+struct utility {
+	const char *name;
+	int (*run)(int argc, char * const argv[]);
+	bool enabled;
+};
+
+/***********************************************************************
+ * lookup_utility()
+ *
+ * RETURN VALUE
+ *  Return the enabled utility named @name, or NULL if there is none
+ *
+ */
+struct utility *lookup_utility(const char *name);
+
+/***********************************************************************
+ * run_utility()
+ *
+ * DESCRIPTION
+ *  Run @utility with @argv in the shell.
+ *
+ * RETURN VALUE
+ *  Return the exit status of the utility
+ *
+ */
+int run_utility(struct utility *utility, char * const argv[]);
+
+/***********************************************************************
+ * run_enable()
+ *
+ * DESCRIPTION
+ *  The enable built-in command:
+ *   enable             : List the utilities and whether they are enabled
+ *   enable name ...    : Run the utilities in the shell
+ *   enable -n name ... : Launch the external commands instead
+ *
+ * RETURN VALUE
+ *  Return 1 as run_command() does
+ *
+ */
+int run_enable(int nr_tokens, char * const tokens[]);
+
+#endif
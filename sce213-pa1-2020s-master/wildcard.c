@@ -0,0 +1,292 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "types.h"
+#include "wildcard.h"
+
+/* As getdents64(2) fills the buffer */
+struct dirent64 {
+	uint64_t d_ino;
+	int64_t d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+/**
+ * The names in a directory as of @mtime, sorted. The directory is identified
+ * by @dev and @ino so that it is found through any path.
+ */
+struct listing {
+	dev_t dev;
+	ino_t ino;
+	struct timespec mtime;
+
+	int nr_names;
+	char **names;		/* Pointing into @strings */
+	char *strings;
+	unsigned long used;	/* Tick of the last use. 0 if the entry is free */
+};
+
+static struct listing __listings[WILDCARD_CACHE_SIZE];
+static unsigned long __tick = 0;
+
+static void __drop(struct listing *l)
+{
+	free(l->names);
+	free(l->strings);
+	l->names = NULL;
+	l->strings = NULL;
+	l->nr_names = 0;
+	l->used = 0;
+}
+
+static int __compare_names(const void *a, const void *b)
+{
+	return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/* Read the names in the directory @fd into @l */
+static int __read_listing(int fd, struct listing *l)
+{
+	static char dents[32 << 10];
+	size_t len = 0, capacity = 4096;
+	char *strings = malloc(capacity);
+	char **names, *name;
+	int nr = 0;
+	long bytes;
+
+	if (!strings) return -ENOMEM;
+
+	while ((bytes = syscall(SYS_getdents64, fd, dents, sizeof(dents))) > 0) {
+		for (long off = 0; off < bytes; ) {
+			struct dirent64 *d = (struct dirent64 *)(dents + off);
+			size_t size = strlen(d->d_name) + 1;
+
+			off += d->d_reclen;
+			if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0)
+				continue;
+
+			if (len + size > capacity) {
+				char *grown;
+
+				capacity *= 2;
+				if (!(grown = realloc(strings, capacity))) {
+					free(strings);
+					return -ENOMEM;
+				}
+				strings = grown;
+			}
+			memcpy(strings + len, d->d_name, size);
+			len += size;
+			nr++;
+		}
+	}
+	if (bytes < 0) {
+		free(strings);
+		return -errno;
+	}
+
+	if (!(names = malloc(sizeof(*names) * (nr + 1)))) {
+		free(strings);
+		return -ENOMEM;
+	}
+	name = strings;
+	for (int i = 0; i < nr; i++) {
+		names[i] = name;
+		name += strlen(name) + 1;
+	}
+	qsort(names, nr, sizeof(*names), __compare_names);
+
+	free(l->names);
+	free(l->strings);
+	l->names = names;
+	l->strings = strings;
+	l->nr_names = nr;
+
+	return 0;
+}
+
+/* Get the names in the directory @path from the cache, or read them */
+static struct listing *__get_listing(const char *path)
+{
+	struct listing *l = NULL, *victim = __listings;
+	struct stat st;
+	int fd;
+
+	if (stat(path, &st)) return NULL;
+
+	for (int i = 0; i < WILDCARD_CACHE_SIZE; i++) {
+		struct listing *c = __listings + i;
+
+		if (c->used && c->dev == st.st_dev && c->ino == st.st_ino) {
+			l = c;
+			break;
+		}
+		if (c->used < victim->used) victim = c;
+	}
+
+	if (l && l->mtime.tv_sec == st.st_mtim.tv_sec &&
+			l->mtime.tv_nsec == st.st_mtim.tv_nsec) {
+		l->used = ++__tick;
+		return l;
+	}
+	if (!l) l = victim;
+
+	/* Take mtime from the open directory so that later changes are noticed */
+	fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0 || fstat(fd, &st) || __read_listing(fd, l)) {
+		if (fd >= 0) close(fd);
+		__drop(l);
+		return NULL;
+	}
+	close(fd);
+
+	l->dev = st.st_dev;
+	l->ino = st.st_ino;
+	l->mtime = st.st_mtim;
+	l->used = ++__tick;
+
+	return l;
+}
+
+bool has_wildcards(const char *token)
+{
+	const char *bracket;
+
+	if (strpbrk(token, "*?")) return true;
+
+	/* A lone [ is the test command */
+	bracket = strchr(token, '[');
+	return bracket && strchr(bracket + 1, ']');
+}
+
+/* Append @n bytes of @str and @suffix to the strings of @w */
+static int __append(struct wildcards *w, size_t *len, size_t *capacity,
+		const char *str, size_t n, const char *suffix)
+{
+	size_t size = n + strlen(suffix) + 1;
+
+	if (*len + size > *capacity) {
+		char *grown;
+
+		*capacity = (*len + size) * 2;
+		if (!(grown = realloc(w->__strings, *capacity))) return -ENOMEM;
+		w->__strings = grown;
+	}
+	memcpy(w->__strings + *len, str, n);
+	strcpy(w->__strings + *len + n, suffix);
+	*len += size;
+	w->nr_tokens++;
+
+	return 0;
+}
+
+int expand_wildcards(int nr_tokens, char *tokens[], struct wildcards *w)
+{
+	size_t len = 0, capacity = 0;
+	char *string;
+	int i;
+
+	w->nr_tokens = nr_tokens;
+	w->tokens = tokens;
+	w->__strings = NULL;
+
+	for (i = 0; i < nr_tokens; i++) {
+		if (has_wildcards(tokens[i])) break;
+	}
+	if (i == nr_tokens) return 0;
+
+	w->nr_tokens = 0;
+	w->tokens = NULL;
+
+	for (i = 0; i < nr_tokens; i++) {
+		char *token = tokens[i];
+		char *slash = strrchr(token, '/');
+		const char *pattern = slash ? slash + 1 : token;
+		size_t dir_len = slash ? slash - token + 1 : 0;
+		struct listing *l = NULL;
+		int nr_before = w->nr_tokens;
+
+		if (has_wildcards(pattern)) {
+			char dir[dir_len + 2];
+
+			if (slash) {
+				memcpy(dir, token, dir_len);
+				dir[dir_len] = '\0';
+			} else {
+				strcpy(dir, ".");
+			}
+			if (!has_wildcards(dir)) l = __get_listing(dir);
+		}
+
+		for (int n = 0; l && n < l->nr_names; n++) {
+			if (fnmatch(pattern, l->names[n], FNM_PERIOD)) continue;
+			if (__append(w, &len, &capacity, token, dir_len, l->names[n]))
+				goto nomem;
+		}
+
+		/* Nothing to expand, or nothing matched */
+		if (w->nr_tokens == nr_before) {
+			if (__append(w, &len, &capacity, token, strlen(token), ""))
+				goto nomem;
+		}
+	}
+
+	/* The array of tokens goes after the strings. Align it */
+	len = (len + sizeof(char *) - 1) & ~(sizeof(char *) - 1);
+	string = realloc(w->__strings, len + sizeof(char *) * (w->nr_tokens + 1));
+	if (!string) goto nomem;
+	w->__strings = string;
+	w->tokens = (char **)(string + len);
+
+	for (i = 0; i < w->nr_tokens; i++) {
+		w->tokens[i] = string;
+		string += strlen(string) + 1;
+	}
+	w->tokens[i] = NULL;
+
+	return 0;
+
+nomem:
+	free(w->__strings);
+	w->__strings = NULL;
+	return -ENOMEM;
+}
+
+void release_wildcards(struct wildcards *w)
+{
+	free(w->__strings);
+	w->__strings = NULL;
+}
+
+void fini_wildcards(void)
+{
+	for (int i = 0; i < WILDCARD_CACHE_SIZE; i++) {
+		__drop(__listings + i);
+	}
+}
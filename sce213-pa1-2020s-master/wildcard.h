@@ -0,0 +1,76 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __WILDCARD_H__
+#define __WILDCARD_H__
+
+#include "types.h"
+
+/**
+ * Tokens having *, ? or [...] are replaced with the sorted names of the files
+ * they match, as sh does. Only the last component of a path may have
+ * wildcards, as in "*.c" and "src/x?.[ch]". Names starting with '.' are
+ * matched only by a pattern starting with '.', and a token matching nothing
+ * is left as it is.
+ *
+ * Directories are read with getdents64() into a small LRU cache, and read
+ * again only when their mtime changes. Expanding a token takes a stat() of
+ * its directory otherwise.
+ */
+#define WILDCARD_CACHE_SIZE	16
+
+struct wildcards {
+	int nr_tokens;
+	char **tokens;		/* NULL-terminated */
+
+	char *__strings;	/* All expanded tokens, each terminated with '\0' */
+};
+
+/***********************************************************************
+ * has_wildcards()
+ *
+ * RETURN VALUE
+ *  Return true if @token has wildcards to expand
+ *
+ */
+bool has_wildcards(const char *token);
+
+/***********************************************************************
+ * expand_wildcards()
+ * release_wildcards()
+ *
+ * DESCRIPTION
+ *  Expand the wildcards in @tokens into @w. When no token has wildcards,
+ *  @w->tokens is @tokens itself and nothing is allocated. Otherwise all the
+ *  tokens are copied into one buffer. Release @w with release_wildcards().
+ *
+ * RETURN VALUE
+ *  Return 0 on success, -errno otherwise
+ *
+ */
+int expand_wildcards(int nr_tokens, char *tokens[], struct wildcards *w);
+void release_wildcards(struct wildcards *w);
+
+/***********************************************************************
+ * fini_wildcards()
+ *
+ * DESCRIPTION
+ *  Drop the cached directories
+ *
+ */
+void fini_wildcards(void);
+
+#endif
@@ -0,0 +1,351 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+
+#include "types.h"
+#include "reaper.h"
+#include "zygote.h"
+
+extern char **environ;
+
+/**
+ * A request is this header followed by @len bytes of NUL-terminated strings;
+ * the path ("" for a $PATH lookup), the working directory, the arguments, and
+ * the environment. The targets of the redirections come as SCM_RIGHTS.
+ */
+struct zygote_request {
+	unsigned int len;
+	unsigned int nr_argv;
+	unsigned int nr_env;
+	unsigned int nr_redirections;
+	int fds[ZYGOTE_MAX_REDIRECTIONS];
+};
+
+struct zygote_reply {
+	pid_t pid;		/* Reap it on error */
+	int error;
+};
+
+static int __zygote_fd = -1;
+static pid_t __zygote_pid = -1;
+
+/* Read exactly @len bytes unless the peer is gone */
+static int __read_all(int fd, void *buffer, size_t len)
+{
+	while (len) {
+		ssize_t ret = read(fd, buffer, len);
+
+		if (ret < 0 && errno == EINTR) continue;
+		if (ret <= 0) return -EPIPE;
+
+		buffer = (char *)buffer + ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+static int __send_all(int fd, const void *buffer, size_t len)
+{
+	while (len) {
+		ssize_t ret = send(fd, buffer, len, MSG_NOSIGNAL);
+
+		if (ret < 0 && errno == EINTR) continue;
+		if (ret <= 0) return -EPIPE;
+
+		buffer = (const char *)buffer + ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+
+/***********************************************************************
+ * The zygote side
+ */
+static void __exec(char *path, char *cwd, char **argv, char **envp,
+		const struct zygote_request *req, const int *targets, int status)
+{
+	int error;
+
+	if (cwd[0]) chdir(cwd);
+
+	for (int i = 0; i < req->nr_redirections; i++) {
+		if (targets[i] == req->fds[i]) {
+			fcntl(targets[i], F_SETFD, 0);
+		} else {
+			dup2(targets[i], req->fds[i]);
+		}
+	}
+
+	if (path[0]) {
+		execve(path, argv, envp);
+	} else {
+		execvpe(argv[0], argv, envp);
+	}
+
+	error = errno;
+	write(status, &error, sizeof(error));
+	_exit(127);
+}
+
+static struct zygote_reply __spawn(char *payload,
+		const struct zygote_request *req, const int *targets)
+{
+	struct zygote_reply reply = { .pid = -1, .error = 0 };
+	char *path = payload;
+	char *cwd = path + strlen(path) + 1;
+	char *p = cwd + strlen(cwd) + 1;
+	char **argv, **envp;
+	int status[2];
+
+	argv = malloc(sizeof(*argv) * (req->nr_argv + req->nr_env + 2));
+	if (!argv) {
+		reply.error = ENOMEM;
+		return reply;
+	}
+	envp = argv + req->nr_argv + 1;
+
+	for (int i = 0; i < req->nr_argv; i++, p += strlen(p) + 1) argv[i] = p;
+	argv[req->nr_argv] = NULL;
+	for (int i = 0; i < req->nr_env; i++, p += strlen(p) + 1) envp[i] = p;
+	envp[req->nr_env] = NULL;
+
+	if (pipe2(status, O_CLOEXEC)) {
+		reply.error = errno;
+		free(argv);
+		return reply;
+	}
+
+	/* Make the command a child of the shell rather than of the zygote */
+	reply.pid = syscall(SYS_clone, CLONE_PARENT | SIGCHLD, 0, 0, 0, 0);
+	if (reply.pid == 0) {
+		close(status[0]);
+		__exec(path, cwd, argv, envp, req, targets, status[1]);
+	}
+	close(status[1]);
+
+	if (reply.pid < 0) {
+		reply.error = errno;
+	} else if (__read_all(status[0], &reply.error, sizeof(reply.error))) {
+		reply.error = 0;	/* Closed on exec */
+	}
+	close(status[0]);
+	free(argv);
+
+	return reply;
+}
+
+static void __serve(int fd)
+{
+	char *payload = NULL;
+	size_t capacity = 0;
+
+	while (true) {
+		struct zygote_request req;
+		struct zygote_reply reply;
+		int targets[ZYGOTE_MAX_REDIRECTIONS];
+		int nr_targets = 0;
+		char control[CMSG_SPACE(sizeof(targets))];
+		struct iovec iov = {
+			.iov_base = &req,
+			.iov_len = sizeof(req),
+		};
+		struct msghdr msg = {
+			.msg_iov = &iov,
+			.msg_iovlen = 1,
+			.msg_control = control,
+			.msg_controllen = sizeof(control),
+		};
+		struct cmsghdr *cmsg;
+		ssize_t ret;
+
+		ret = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+		if (ret < 0 && errno == EINTR) continue;
+		if (ret != sizeof(req)) break;
+
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			if (cmsg->cmsg_level != SOL_SOCKET ||
+					cmsg->cmsg_type != SCM_RIGHTS) continue;
+
+			nr_targets = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			memcpy(targets, CMSG_DATA(cmsg), sizeof(int) * nr_targets);
+		}
+		if (nr_targets != req.nr_redirections) break;
+
+		if (req.len > capacity) {
+			free(payload);
+			capacity = req.len;
+			if (!(payload = malloc(capacity))) break;
+		}
+		if (__read_all(fd, payload, req.len)) break;
+
+		reply = __spawn(payload, &req, targets);
+
+		for (int i = 0; i < nr_targets; i++) close(targets[i]);
+
+		if (__send_all(fd, &reply, sizeof(reply))) break;
+	}
+
+	_exit(0);
+}
+
+
+/***********************************************************************
+ * The shell side
+ */
+int init_zygote(void)
+{
+	const sigset_t *sigmask = reaper_sigmask();
+	int fds[2];
+	pid_t pid;
+
+	if (__zygote_fd >= 0) return 0;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds)) return -errno;
+
+	pid = fork();
+	if (pid < 0) {
+		int ret = -errno;
+
+		close(fds[0]);
+		close(fds[1]);
+		return ret;
+	}
+
+	if (pid == 0) {
+		close(fds[0]);
+
+		/* Go away with the shell, and hand the commands a clean mask */
+		prctl(PR_SET_PDEATHSIG, SIGKILL);
+		if (getppid() == 1) _exit(0);
+		if (sigmask) sigprocmask(SIG_SETMASK, sigmask, NULL);
+
+		__serve(fds[1]);
+	}
+	close(fds[1]);
+
+	__zygote_fd = fds[0];
+	__zygote_pid = pid;
+
+	return 0;
+}
+
+void fini_zygote(void)
+{
+	if (__zygote_fd < 0) return;
+
+	/* The zygote exits on EOF */
+	close(__zygote_fd);
+	waitpid(__zygote_pid, NULL, 0);
+
+	__zygote_fd = -1;
+	__zygote_pid = -1;
+}
+
+bool zygote_running(void)
+{
+	return __zygote_fd >= 0;
+}
+
+pid_t zygote_launch(const char *path, char * const argv[],
+		const struct redirection *redirections, int nr_redirections)
+{
+	struct zygote_request req = {
+		.len = 0,
+		.nr_redirections = nr_redirections,
+	};
+	struct zygote_reply reply;
+	int targets[ZYGOTE_MAX_REDIRECTIONS];
+	char control[CMSG_SPACE(sizeof(targets))] = { 0 };
+	struct iovec iov = {
+		.iov_base = &req,
+		.iov_len = sizeof(req),
+	};
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+	};
+	char cwd[PATH_MAX];
+	char *payload, *p;
+
+	if (__zygote_fd < 0) return -EPIPE;
+	if (nr_redirections > ZYGOTE_MAX_REDIRECTIONS) return -E2BIG;
+
+	if (!getcwd(cwd, sizeof(cwd))) cwd[0] = '\0';
+	if (!path) path = "";
+
+	req.len = strlen(path) + 1 + strlen(cwd) + 1;
+	for (req.nr_argv = 0; argv[req.nr_argv]; req.nr_argv++) {
+		req.len += strlen(argv[req.nr_argv]) + 1;
+	}
+	for (req.nr_env = 0; environ[req.nr_env]; req.nr_env++) {
+		req.len += strlen(environ[req.nr_env]) + 1;
+	}
+
+	p = payload = malloc(req.len);
+	if (!payload) return -ENOMEM;
+
+	p = stpcpy(p, path) + 1;
+	p = stpcpy(p, cwd) + 1;
+	for (int i = 0; i < req.nr_argv; i++) p = stpcpy(p, argv[i]) + 1;
+	for (int i = 0; i < req.nr_env; i++) p = stpcpy(p, environ[i]) + 1;
+
+	if (nr_redirections) {
+		struct cmsghdr *cmsg;
+
+		for (int i = 0; i < nr_redirections; i++) {
+			req.fds[i] = redirections[i].fd;
+			targets[i] = redirections[i].target;
+		}
+
+		msg.msg_control = control;
+		msg.msg_controllen = CMSG_SPACE(sizeof(int) * nr_redirections);
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int) * nr_redirections);
+		memcpy(CMSG_DATA(cmsg), targets, sizeof(int) * nr_redirections);
+	}
+
+	if (sendmsg(__zygote_fd, &msg, MSG_NOSIGNAL) != sizeof(req) ||
+			__send_all(__zygote_fd, payload, req.len) ||
+			__read_all(__zygote_fd, &reply, sizeof(reply))) {
+		free(payload);
+		fini_zygote();
+		return -EPIPE;
+	}
+	free(payload);
+
+	if (reply.error) {
+		if (reply.pid > 0) waitpid(reply.pid, NULL, 0);
+		return -reply.error;
+	}
+	return reply.pid;
+}
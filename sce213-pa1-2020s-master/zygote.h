@@ -0,0 +1,67 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+
+#ifndef __ZYGOTE_H__
+#define __ZYGOTE_H__
+
+#include <sys/types.h>
+
+#include "launch.h"
+
+#define ZYGOTE_MAX_REDIRECTIONS	16
+
+/***********************************************************************
+ * init_zygote()
+ * fini_zygote()
+ *
+ * DESCRIPTION
+ *  Fork the zygote, a helper process that launches commands on behalf of
+ *  the shell. Since the zygote is forked while the shell is still small,
+ *  launching through it does not get slower as the shell grows. Start it
+ *  before spawning threads, and after init_reaper() so that it can hand the
+ *  original signal mask to the commands.
+ *
+ *  The commands are created with CLONE_PARENT, so they are children of the
+ *  shell and are waited for as usual. Their standard streams are those of the
+ *  shell at init_zygote() unless redirected.
+ *
+ * RETURN VALUE
+ *  init_zygote() returns 0 on success, -errno otherwise
+ *
+ */
+int init_zygote(void);
+void fini_zygote(void);
+bool zygote_running(void);
+
+/***********************************************************************
+ * zygote_launch()
+ *
+ * DESCRIPTION
+ *  Have the zygote launch @argv with the environment and the working
+ *  directory of the shell. The executable is @path, or is looked up in $PATH
+ *  if @path is NULL. Up to ZYGOTE_MAX_REDIRECTIONS @redirections are passed
+ *  to the zygote along with the file descriptors.
+ *
+ * RETURN VALUE
+ *  Return the pid of the child
+ *  Return -errno if the command cannot be executed
+ *  Return -EPIPE if the zygote is gone. It is not used afterward
+ *
+ */
+pid_t zygote_launch(const char *path, char * const argv[],
+		const struct redirection *redirections, int nr_redirections);
+
+#endif
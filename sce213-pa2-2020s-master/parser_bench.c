@@ -0,0 +1,529 @@
+/**********************************************************************
+ * Copyright (c) 2020
+ *  Sang-Hoon Kim <sanghoonkim@ajou.ac.kr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTIABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ **********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "types.h"
+#include "parser.h"
+
+/**
+ * Tokenizer benchmark.
+ *
+ * Each corpus is generated from a fixed seed so that every run tokenizes
+ * exactly the same bytes. Every variant is run @nr_runs times on it and the
+ * best run is reported, so numbers from different builds of the parser can
+ * be compared directly.
+ */
+static size_t corpus_size = 16 << 20;
+static int nr_runs = 5;
+static int nr_threads = 0;
+static uint64_t seed = 0x2020;
+
+/* xorshift64*; rand() is not guaranteed to be the same across libcs */
+static uint64_t __rng;
+
+static inline uint64_t __random(void)
+{
+	__rng ^= __rng >> 12;
+	__rng ^= __rng << 25;
+	__rng ^= __rng >> 27;
+	return __rng * 0x2545f4914f6cdd1dULL;
+}
+
+static inline unsigned int __random_range(unsigned int lo, unsigned int hi)
+{
+	return lo + __random() % (hi - lo + 1);
+}
+
+
+/***********************************************************************
+ * Corpus generators. Each appends one line to @p and returns its end.
+ */
+static const char *words[] = {
+	"process", "lifespan", "prio", "start", "resource", "acquire", "release",
+	"ls", "-al", "cd", "..", "echo", "cat", "grep", "-n", "timeout", "for",
+	"sleep", "read", "write", "/usr/bin/env", "./toy", "hello", "world",
+};
+#define NR_WORDS (sizeof(words) / sizeof(*words))
+
+static char *__put_word(char *p)
+{
+	const char *w = words[__random() % NR_WORDS];
+	size_t len = strlen(w);
+
+	memcpy(p, w, len);
+	return p + len;
+}
+
+static char *__put_number(char *p)
+{
+	return p + sprintf(p, "%u", __random_range(0, 99999));
+}
+
+static char *__put_arg(char *p)
+{
+	return __random() % 3 ? __put_word(p) : __put_number(p);
+}
+
+static char *__gen_short(char *p)
+{
+	int nr_args = __random_range(0, 3);
+
+	p = __put_word(p);
+	for (int i = 0; i < nr_args; i++) {
+		*p++ = ' ';
+		p = __put_arg(p);
+	}
+	*p++ = '\n';
+	return p;
+}
+
+static char *__gen_long(char *p)
+{
+	int nr_args = __random_range(64, 256);
+
+	p = __put_word(p);
+	for (int i = 0; i < nr_args; i++) {
+		*p++ = ' ';
+		p = __put_arg(p);
+	}
+	*p++ = '\n';
+	return p;
+}
+
+static char *__gen_quoted(char *p)
+{
+	int nr_args = __random_range(2, 8);
+
+	p = __put_word(p);
+	for (int i = 0; i < nr_args; i++) {
+		char quote = __random() % 2 ? '"' : '\'';
+
+		*p++ = ' ';
+		*p++ = quote;
+		p = __put_arg(p);
+		if (__random() % 2) {
+			*p++ = ' ';
+			p = __put_arg(p);
+		}
+		*p++ = quote;
+	}
+	*p++ = '\n';
+	return p;
+}
+
+static char *__put_blanks(char *p, int min)
+{
+	int nr_blanks = __random_range(min, 4);
+
+	for (int i = 0; i < nr_blanks; i++) {
+		*p++ = __random() % 2 ? '\t' : ' ';
+	}
+	return p;
+}
+
+static char *__gen_tabs(char *p)
+{
+	int nr_args = __random_range(1, 8);
+
+	p = __put_blanks(p, 0);
+	p = __put_word(p);
+	for (int i = 0; i < nr_args; i++) {
+		p = __put_blanks(p, 1);
+		p = __put_arg(p);
+	}
+	p = __put_blanks(p, 0);
+	*p++ = '\n';
+	return p;
+}
+
+static char *__gen_comments(char *p)
+{
+	int nr_words = __random_range(2, 10);
+
+	if (__random() % 2) {
+		*p++ = '#';
+		for (int i = 0; i < nr_words; i++) {
+			*p++ = ' ';
+			p = __put_word(p);
+		}
+		*p++ = '\n';
+		return p;
+	}
+
+	p = __gen_short(p);
+	p[-1] = ' ';
+	*p++ = '#';
+	for (int i = 0; i < nr_words; i++) {
+		*p++ = ' ';
+		p = __put_word(p);
+	}
+	*p++ = '\n';
+	return p;
+}
+
+/* Longest line a generator can emit */
+#define MAX_LINE_LEN	(256 * 8 + 64)
+
+static const struct corpus {
+	const char *name;
+	char *(*generate)(char *p);
+} corpora[] = {
+	{ "short", __gen_short },
+	{ "long", __gen_long },
+	{ "quoted", __gen_quoted },
+	{ "tabs", __gen_tabs },
+	{ "comments", __gen_comments },
+};
+#define NR_CORPORA (sizeof(corpora) / sizeof(*corpora))
+
+static const struct corpus *__find_corpus(const char *name)
+{
+	for (int i = 0; i < NR_CORPORA; i++) {
+		if (strcmp(corpora[i].name, name) == 0) return corpora + i;
+	}
+	return NULL;
+}
+
+/**
+ * Generate about corpus_size bytes of whole lines. Return the size.
+ */
+static size_t __generate(const struct corpus *corpus, char *buffer)
+{
+	char *p = buffer;
+
+	__rng = seed ? seed : 1;
+	while (p - buffer + MAX_LINE_LEN <= corpus_size) {
+		p = corpus->generate(p);
+	}
+	return p - buffer;
+}
+
+
+/***********************************************************************
+ * Measurement
+ */
+static double __now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void __report(const char *corpus, const char *variant,
+		size_t size, size_t nr_tokens, double elapsed)
+{
+	printf("%-10s %-14s %10.1f %12.2f\n", corpus, variant,
+			size / elapsed / 1e6, nr_tokens / elapsed / 1e6);
+}
+
+/**
+ * Tokenize the corpus line by line with parse_command_vector(), as the
+ * interpreters do for fgets() input. @lines holds each line followed by '\0'
+ * and is copied into @work before each run since the parser modifies it.
+ */
+static int __bench_lines(const char *lines, size_t lines_size, char *work,
+		char **line_ptrs, size_t nr_lines, size_t *nr_tokens, double *best)
+{
+	struct token_vector tv = { NULL };
+
+	*best = 0;
+	for (int run = 0; run < nr_runs; run++) {
+		size_t tokens = 0;
+		double start;
+
+		memcpy(work, lines, lines_size);
+
+		start = __now();
+		for (size_t i = 0; i < nr_lines; i++) {
+			if (parse_command_vector(line_ptrs[i], &tv) < 0) {
+				free(tv.tokens);
+				return -ENOMEM;
+			}
+			tokens += tv.nr_tokens;
+		}
+		start = __now() - start;
+
+		if (!*best || start < *best) *best = start;
+		*nr_tokens = tokens;
+	}
+	free(tv.tokens);
+	return 0;
+}
+
+/**
+ * Tokenize the whole corpus file with parse_fd_parallel(), including the
+ * cost of mapping it.
+ */
+static int __bench_file(int fd, int threads, size_t *nr_tokens, double *best)
+{
+	*best = 0;
+	for (int run = 0; run < nr_runs; run++) {
+		struct parsed_file pf;
+		double start = __now();
+		int ret = parse_fd_parallel(fd, &pf, threads);
+
+		start = __now() - start;
+		if (ret) return ret;
+
+		if (!*best || start < *best) *best = start;
+		*nr_tokens = pf.nr_tokens;
+		free_parsed_file(&pf);
+	}
+	return 0;
+}
+
+/**
+ * An empty file yields no line however many threads are asked for
+ */
+static int __check_empty(void)
+{
+	char tmpname[] = "/tmp/parser_bench.XXXXXX";
+	int fd = mkstemp(tmpname);
+	int ret = 0;
+
+	if (fd < 0) return -errno;
+	unlink(tmpname);
+
+	for (int threads = 1; threads <= 4 && !ret; threads++) {
+		struct parsed_file pf;
+
+		if ((ret = parse_fd_parallel(fd, &pf, threads))) break;
+
+		if (pf.nr_lines || pf.nr_tokens) {
+			fprintf(stderr, "empty/file*%d: %zu lines and %zu tokens\n",
+					threads, pf.nr_lines, pf.nr_tokens);
+			ret = -EINVAL;
+		}
+		free_parsed_file(&pf);
+	}
+	close(fd);
+
+	return ret;
+}
+
+static int __bench_corpus(const struct corpus *corpus, char *buffer,
+		char *lines, char *work, char **line_ptrs)
+{
+	static const char *impls[] = { "scalar", "sse2", "avx2" };
+	const char *initial = parser_selected();
+	size_t size = __generate(corpus, buffer);
+	size_t lines_size = 0, nr_lines = 0;
+	size_t expected = 0;
+	char tmpname[] = "/tmp/parser_bench.XXXXXX";
+	int fd;
+	int ret = 0;
+
+	/* Split the corpus into NUL-terminated lines for the line-by-line runs */
+	for (size_t i = 0; i < size; i++) {
+		if (i == 0 || buffer[i - 1] == '\n') {
+			line_ptrs[nr_lines++] = work + lines_size;
+		}
+		lines[lines_size++] = buffer[i];
+		if (buffer[i] == '\n') lines[lines_size++] = '\0';
+	}
+
+	fd = mkstemp(tmpname);
+	if (fd < 0) return -errno;
+	unlink(tmpname);
+	if (write(fd, buffer, size) != size) {
+		ret = -EIO;
+		goto out;
+	}
+
+	for (int i = 0; i < sizeof(impls) / sizeof(*impls); i++) {
+		char variant[32];
+		size_t nr_tokens;
+		double elapsed;
+
+		if (parser_select(impls[i])) continue;
+
+		ret = __bench_lines(lines, lines_size, work, line_ptrs, nr_lines,
+				&nr_tokens, &elapsed);
+		if (ret) goto out;
+		if (!expected) expected = nr_tokens;
+		snprintf(variant, sizeof(variant), "%s/line", impls[i]);
+		__report(corpus->name, variant, size, nr_tokens, elapsed);
+		if (nr_tokens != expected) {
+			fprintf(stderr, "%s: %zu tokens while expecting %zu\n",
+					variant, nr_tokens, expected);
+			ret = -EINVAL;
+			goto out;
+		}
+
+		ret = __bench_file(fd, 1, &nr_tokens, &elapsed);
+		if (ret) goto out;
+		snprintf(variant, sizeof(variant), "%s/file", impls[i]);
+		__report(corpus->name, variant, size, nr_tokens, elapsed);
+		if (nr_tokens != expected) {
+			fprintf(stderr, "%s: %zu tokens while expecting %zu\n",
+					variant, nr_tokens, expected);
+			ret = -EINVAL;
+			goto out;
+		}
+	}
+	parser_select(initial);
+
+	if (nr_threads > 1) {
+		char variant[32];
+		size_t nr_tokens;
+		double elapsed;
+
+		ret = __bench_file(fd, nr_threads, &nr_tokens, &elapsed);
+		if (ret) goto out;
+		snprintf(variant, sizeof(variant), "%s/file*%d",
+				initial, nr_threads);
+		__report(corpus->name, variant, size, nr_tokens, elapsed);
+		if (nr_tokens != expected) {
+			fprintf(stderr, "%s: %zu tokens while expecting %zu\n",
+					variant, nr_tokens, expected);
+			ret = -EINVAL;
+			goto out;
+		}
+	}
+
+out:
+	parser_select(initial);
+	close(fd);
+	return ret;
+}
+
+static int __dump_corpus(const struct corpus *corpus, char *buffer)
+{
+	size_t size = __generate(corpus, buffer);
+
+	if (fwrite(buffer, 1, size, stdout) != size) return -EIO;
+	return 0;
+}
+
+
+static void __print_usage(const char *argv0)
+{
+	printf("Usage: %s {options} [corpus ...]\n", argv0);
+	printf("\n");
+	printf(" Benchmark the tokenizer on synthetic corpora;");
+	for (int i = 0; i < NR_CORPORA; i++) {
+		printf(" %s", corpora[i].name);
+	}
+	printf("\n");
+	printf("  -s [number]: Generate @number MiB per corpus (default 16)\n");
+	printf("  -r [number]: Report the best of @number runs (default 5)\n");
+	printf("  -j [number]: Also tokenize with @number threads\n");
+	printf("  -S [number]: Seed the corpus generator with @number\n");
+	printf("  -g [corpus]: Write @corpus to stdout instead of benchmarking\n");
+	printf("\n");
+	printf("  -h | -?    : Print usage\n");
+	printf("\n");
+}
+
+int main(int argc, char * const argv[])
+{
+	int opt;
+	const struct corpus *dump = NULL;
+	char *buffer, *lines, *work;
+	char **line_ptrs;
+	int ret = EXIT_SUCCESS;
+
+	while ((opt = getopt(argc, argv, "s:r:j:S:g:h?")) != -1) {
+		switch (opt) {
+		case 's':
+			corpus_size = (size_t)atoi(optarg) << 20;
+			break;
+		case 'r':
+			nr_runs = atoi(optarg);
+			break;
+		case 'j':
+			nr_threads = atoi(optarg);
+			break;
+		case 'S':
+			seed = strtoull(optarg, NULL, 0);
+			break;
+		case 'g':
+			dump = __find_corpus(optarg);
+			if (!dump) {
+				fprintf(stderr, "Unknown corpus %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'h':
+		case '?':
+		default:
+			__print_usage(argv[0]);
+			return EXIT_SUCCESS;
+		}
+	}
+	if (corpus_size < MAX_LINE_LEN || nr_runs <= 0) {
+		__print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (nr_threads <= 0) nr_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	buffer = malloc(corpus_size);
+	if (!buffer) return EXIT_FAILURE;
+
+	if (dump) {
+		ret = __dump_corpus(dump, buffer) ? EXIT_FAILURE : EXIT_SUCCESS;
+		free(buffer);
+		return ret;
+	}
+
+	/* A line is at least one character and a newline */
+	lines = malloc(corpus_size + corpus_size / 2);
+	work = malloc(corpus_size + corpus_size / 2);
+	line_ptrs = malloc(sizeof(*line_ptrs) * (corpus_size / 2));
+	if (!lines || !work || !line_ptrs) {
+		ret = EXIT_FAILURE;
+		goto out;
+	}
+
+	if (__check_empty()) {
+		ret = EXIT_FAILURE;
+		goto out;
+	}
+
+	printf("%zu MiB per corpus, best of %d runs, seed %#llx, %s by default\n",
+			corpus_size >> 20, nr_runs, (unsigned long long)seed,
+			parser_selected());
+	printf("%-10s %-14s %10s %12s\n", "corpus", "variant", "MB/s", "Mtokens/s");
+
+	for (int i = 0; i < NR_CORPORA; i++) {
+		bool selected = optind >= argc;
+
+		for (int j = optind; j < argc; j++) {
+			if (strcmp(argv[j], corpora[i].name) == 0) selected = true;
+		}
+		if (!selected) continue;
+
+		if (__bench_corpus(corpora + i, buffer, lines, work, line_ptrs)) {
+			ret = EXIT_FAILURE;
+			break;
+		}
+	}
+
+out:
+	free(line_ptrs);
+	free(work);
+	free(lines);
+	free(buffer);
+
+	return ret;
+}
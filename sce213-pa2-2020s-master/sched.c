@@ -27,6 +27,7 @@
 #include "list_head.h"
 
 #include "parser.h"
+#include "keywords.h"
 #include "process.h"
 #include "resource.h"
 
@@ -134,11 +135,6 @@ void dump_status(void)
 	fprintf(stderr, string "\n", ##args); \
 } while (0);
 
-static inline bool strmatch(char * const str, const char *expect)
-{
-	return (strlen(str) == strlen(expect)) && (strncmp(str, expect, strlen(expect)) == 0);
-}
-
 static void __briefing_process(struct process *p)
 {
 	struct resource_schedule *rs;
@@ -156,72 +152,90 @@ static void __briefing_process(struct process *p)
 
 static int __load_script(char * const filename)
 {
-	char line[256];
+	struct parsed_file script;
 	struct process *p = NULL;
+	int ret = false;
 
-	FILE *file = fopen(filename, "r");
-	while (fgets(line, sizeof(line), file)) {
-		char *tokens[32] = { NULL };
-		int nr_tokens;
+	if (parse_file(filename, &script)) {
+		fprintf(stderr, "Unable to load script %s\n", filename);
+		return false;
+	}
 
-		parse_command(line, &nr_tokens, tokens);
+	for (size_t line = 0; line < script.nr_lines; line++) {
+		size_t t = script.line_start[line];
+		int nr_tokens = script.line_start[line + 1] - t;
+		const char *token;
+		size_t len;
 
 		if (nr_tokens == 0) continue;
 
-		if (strmatch(tokens[0], "process")) {
+		token = parsed_token(&script, t);
+		len = script.token_len[t];
+
+		switch (keyword_lookup(token, len)) {
+		case KW_PROCESS:
 			assert(nr_tokens == 2);
 			/* Start processor description */
 			p = malloc(sizeof(*p));
 			memset(p, 0x00, sizeof(*p));
 
-			p->pid = atoi(tokens[1]);
+			p->pid = atoi(parsed_token(&script, t + 1));
 
 			INIT_LIST_HEAD(&p->list);
 			INIT_LIST_HEAD(&p->__resources_to_acquire);
 			INIT_LIST_HEAD(&p->__resources_holding);
+			break;
 
-			continue;
-		} else if (strmatch(tokens[0], "end")) {
+		case KW_END:
 			/* End of process description */
-			struct resource_schedule *rs;
 			assert(p);
 
 			list_add_tail(&p->list, &__forkqueue);
 
 			__briefing_process(p);
 			p = NULL;
+			break;
 
-			continue;
-		}
-
-		if (strmatch(tokens[0], "lifespan")) {
+		case KW_LIFESPAN:
 			assert(nr_tokens == 2);
-			p->lifespan = atoi(tokens[1]);
-		} else if (strmatch(tokens[0], "prio")) {
+			p->lifespan = atoi(parsed_token(&script, t + 1));
+			break;
+
+		case KW_PRIO:
 			assert(nr_tokens == 2);
-			p->prio = p->prio_orig = atoi(tokens[1]);
-		} else if (strmatch(tokens[0], "start")) {
+			p->prio = p->prio_orig = atoi(parsed_token(&script, t + 1));
+			break;
+
+		case KW_START:
 			assert(nr_tokens == 2);
-			p->__starts_at = atoi(tokens[1]);
-		} else if (strmatch(tokens[0], "acquire")) {
+			p->__starts_at = atoi(parsed_token(&script, t + 1));
+			break;
+
+		case KW_ACQUIRE: {
 			struct resource_schedule *rs;
 			assert(nr_tokens == 4);
 
 			rs = malloc(sizeof(*rs));
 
-			rs->resource_id = atoi(tokens[1]);
-			rs->at = atoi(tokens[2]);
-			rs->duration = atoi(tokens[3]);
+			rs->resource_id = atoi(parsed_token(&script, t + 1));
+			rs->at = atoi(parsed_token(&script, t + 2));
+			rs->duration = atoi(parsed_token(&script, t + 3));
 
 			list_add_tail(&rs->list, &p->__resources_to_acquire);
-		} else {
-			fprintf(stderr, "Unknown property %s\n", tokens[0]);
-			return false;
+			break;
+		}
+
+		default:
+			fprintf(stderr, "Unknown property %.*s\n", (int)len, token);
+			goto out;
 		}
 	}
-	fclose(file);
 	if (!quiet) printf("\n");
-	return true;
+	ret = true;
+
+out:
+	free_parsed_file(&script);
+	return ret;
 }
 
 
@@ -13,17 +13,81 @@
  *
  **********************************************************************/
 
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD
+#endif
 
 #include "types.h"
 #include "parser.h"
 
-int parse_command(char *command, int *nr_tokens, char *tokens[])
+/* Cut the command at the first token starting with '#' */
+#define STRIP_COMMENTS	true
+
+/**
+ * The vectorized parser classifies the command in blocks of BLOCK_SIZE bytes.
+ * Bit i of each mask corresponds to the i-th byte of the block.
+ */
+#define BLOCK_SIZE	64
+
+struct block_class {
+	uint64_t space;	/* isspace() characters */
+	uint64_t newline; /* '\n' */
+	uint64_t nul;	/* The terminating '\0' */
+};
+
+static void (*__classify)(const char *block, struct block_class *c) = NULL;
+
+
+static int __grow_token_vector(struct token_vector *tv)
+{
+	int capacity = tv->capacity ? tv->capacity * 2 : MAX_NR_TOKENS;
+	char **tokens;
+
+	if (tv->__fixed) return -ENOSPC;
+
+	tokens = realloc(tv->tokens, sizeof(*tokens) * capacity);
+	if (!tokens) return -ENOMEM;
+
+	tv->tokens = tokens;
+	tv->capacity = capacity;
+	return 0;
+}
+
+/**
+ * Append @token to @tv while keeping a room for the terminating NULL. Fixed
+ * vectors are filled up as parse_command() always did
+ */
+static inline int __push_token(struct token_vector *tv, char *token)
+{
+	if (tv->nr_tokens + !tv->__fixed >= tv->capacity) {
+		int ret = __grow_token_vector(tv);
+		if (ret) return ret;
+	}
+	tv->tokens[tv->nr_tokens++] = token;
+	return 0;
+}
+
+
+/***********************************************************************
+ * Scalar parser. Used when the processor has no usable vector unit.
+ */
+static int __parse_command_scalar(char *command, struct token_vector *tv)
 {
 	char *curr = command;
 	int token_started = false;
-	*nr_tokens = 0;
+	int ret = 0;
 
 	while (*curr != '\0') {
 		if (isspace(*curr)) {
@@ -31,8 +95,7 @@ int parse_command(char *command, int *nr_tokens, char *tokens[])
 			token_started = false;
 		} else {
 			if (!token_started) {
-				tokens[*nr_tokens] = curr;
-				*nr_tokens += 1;
+				if (!ret) ret = __push_token(tv, curr);
 				token_started = true;
 			}
 		}
@@ -40,13 +103,675 @@ int parse_command(char *command, int *nr_tokens, char *tokens[])
 		curr++;
 	}
 
-	for (int i = 0; i < *nr_tokens; i++) {
-		if (strncmp(tokens[i], "#", strlen("#")) == 0) {
-			*nr_tokens = i;
-			tokens[i] = NULL;
+	/* Remove comments */
+	for (int i = 0; STRIP_COMMENTS && i < tv->nr_tokens; i++) {
+		if (strncmp(tv->tokens[i], "#", strlen("#")) == 0) {
+			tv->nr_tokens = i;
 			break;
 		}
 	}
 
-	return (*nr_tokens > 0);
+	return ret;
+}
+
+
+#ifdef HAVE_X86_SIMD
+/**
+ * isspace() in the C locale is true for ' ' and '\t' ... '\r'. The latter is
+ * tested with a single signed comparison by biasing '\t' to -128.
+ */
+#define CTRL_SPACE_BIAS		(0x80 - '\t')
+#define CTRL_SPACE_LIMIT	(-128 + ('\r' - '\t') + 1)
+
+static void __classify_sse2(const char *block, struct block_class *c)
+{
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i bias = _mm_set1_epi8(CTRL_SPACE_BIAS);
+	const __m128i limit = _mm_set1_epi8(CTRL_SPACE_LIMIT);
+	const __m128i newline = _mm_set1_epi8('\n');
+	const __m128i zero = _mm_setzero_si128();
+
+	c->space = c->newline = c->nul = 0;
+
+	for (int i = 0; i < BLOCK_SIZE; i += 16) {
+		__m128i v = _mm_load_si128((const __m128i *)(block + i));
+		__m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, space),
+				_mm_cmplt_epi8(_mm_add_epi8(v, bias), limit));
+
+		c->space |= (uint64_t)(uint16_t)_mm_movemask_epi8(ws) << i;
+		c->newline |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+				_mm_cmpeq_epi8(v, newline)) << i;
+		c->nul |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+				_mm_cmpeq_epi8(v, zero)) << i;
+	}
+}
+
+__attribute__((target("avx2")))
+static void __classify_avx2(const char *block, struct block_class *c)
+{
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i bias = _mm256_set1_epi8(CTRL_SPACE_BIAS);
+	const __m256i limit = _mm256_set1_epi8(CTRL_SPACE_LIMIT);
+	const __m256i newline = _mm256_set1_epi8('\n');
+	const __m256i zero = _mm256_setzero_si256();
+
+	c->space = c->newline = c->nul = 0;
+
+	for (int i = 0; i < BLOCK_SIZE; i += 32) {
+		__m256i v = _mm256_load_si256((const __m256i *)(block + i));
+		__m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+				_mm256_cmpgt_epi8(limit, _mm256_add_epi8(v, bias)));
+
+		c->space |= (uint64_t)(uint32_t)_mm256_movemask_epi8(ws) << i;
+		c->newline |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+				_mm256_cmpeq_epi8(v, newline)) << i;
+		c->nul |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+				_mm256_cmpeq_epi8(v, zero)) << i;
+	}
+}
+
+__attribute__((constructor))
+static void __select_classifier(void)
+{
+	if (parser_select("avx2")) parser_select("sse2");
+}
+#endif
+
+int parser_select(const char *impl)
+{
+	if (strcmp(impl, "scalar") == 0) {
+		__classify = NULL;
+		return 0;
+	}
+#ifdef HAVE_X86_SIMD
+	__builtin_cpu_init();
+
+	if (strcmp(impl, "sse2") == 0 && __builtin_cpu_supports("sse2")) {
+		__classify = __classify_sse2;
+		return 0;
+	}
+	if (strcmp(impl, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+		__classify = __classify_avx2;
+		return 0;
+	}
+#endif
+	return -EINVAL;
+}
+
+const char *parser_selected(void)
+{
+#ifdef HAVE_X86_SIMD
+	if (__classify == __classify_avx2) return "avx2";
+	if (__classify == __classify_sse2) return "sse2";
+#endif
+	return "scalar";
+}
+
+
+/***********************************************************************
+ * Vectorized parser
+ *
+ * The command is walked in BLOCK_SIZE-aligned blocks so that no load crosses
+ * a page boundary; bytes before @command and after the terminating '\0' are
+ * loaded but masked out. Token boundaries are then found from the masks:
+ * a token starts at a non-space byte following a space (or the beginning of
+ * the command), and ends at a space or '\0' following a non-space byte.
+ */
+static int __parse_command_blocks(char *command, struct token_vector *tv)
+{
+	unsigned int offset = (uintptr_t)command % BLOCK_SIZE;
+	char *block = command - offset;
+	uint64_t valid = ~0ULL << offset;
+	uint64_t carry = 0;	/* Whether the previous byte was in a token */
+	int ret = 0;
+
+	for (;; block += BLOCK_SIZE, valid = ~0ULL) {
+		struct block_class c;
+		uint64_t word, prev, starts, ends;
+
+		__classify(block, &c);
+
+		/* Drop everything from the terminating '\0' */
+		c.nul &= valid;
+		c.nul &= -c.nul;
+		if (c.nul) valid &= c.nul - 1;
+
+		word = ~c.space & valid;
+		prev = (word << 1) | carry;
+		starts = word & ~prev;
+		ends = ~word & prev & (valid | c.nul);
+		carry = word >> (BLOCK_SIZE - 1);
+
+		while (ends) {
+			block[__builtin_ctzll(ends)] = '\0';
+			ends &= ends - 1;
+		}
+
+		while (starts && !ret) {
+			char *token = block + __builtin_ctzll(starts);
+
+			if (STRIP_COMMENTS && *token == '#') return ret;
+
+			ret = __push_token(tv, token);
+			starts &= starts - 1;
+		}
+
+		if (c.nul) break;
+	}
+
+	return ret;
+}
+
+int parse_command_vector(char *command, struct token_vector *tv)
+{
+	int ret;
+
+	tv->nr_tokens = 0;
+	if (!tv->capacity && (ret = __grow_token_vector(tv))) return ret;
+
+	if (__classify) {
+		ret = __parse_command_blocks(command, tv);
+	} else {
+		ret = __parse_command_scalar(command, tv);
+	}
+	if (tv->nr_tokens < tv->capacity) tv->tokens[tv->nr_tokens] = NULL;
+
+	if (ret) return ret;
+	return (tv->nr_tokens > 0);
+}
+
+int parse_command(char *command, int *nr_tokens, char *tokens[])
+{
+	struct token_vector tv = {
+		.tokens = tokens,
+		.capacity = MAX_NR_TOKENS,
+		.__fixed = true,
+	};
+	int ret = parse_command_vector(command, &tv);
+
+	*nr_tokens = tv.nr_tokens;
+	return ret;
+}
+
+
+/***********************************************************************
+ * Streaming parser
+ */
+#define COMMAND_STREAM_CHUNK	(64 << 10)
+
+void init_command_stream(struct command_stream *cs, int fd)
+{
+	memset(cs, 0x00, sizeof(*cs));
+	cs->fd = fd;
+}
+
+void free_command_stream(struct command_stream *cs)
+{
+	free(cs->buffer);
+	free(cs->tv.tokens);
+	init_command_stream(cs, -1);
+}
+
+/* Make the tokens in @tv point into @to after @from is moved there */
+static void __rebase_tokens(struct token_vector *tv, const char *from, char *to)
+{
+	for (int i = 0; i < tv->nr_tokens; i++) {
+		tv->tokens[i] = to + (tv->tokens[i] - from);
+	}
+}
+
+/**
+ * Read the next chunk after the command being tokenized. The partial command
+ * is moved to the head of the buffer, and the buffer is grown only when the
+ * command alone fills it.
+ */
+static int __fill_command_stream(struct command_stream *cs)
+{
+	ssize_t nr_read;
+
+	if (cs->begin) {
+		memmove(cs->buffer, cs->buffer + cs->begin, cs->end - cs->begin);
+		__rebase_tokens(&cs->tv, cs->buffer + cs->begin, cs->buffer);
+		cs->cursor -= cs->begin;
+		cs->end -= cs->begin;
+		cs->begin = 0;
+	}
+
+	/* Keep a room for the '\0' terminating the last command */
+	if (cs->capacity - cs->end < MAX_COMMAND_LEN) {
+		size_t capacity = cs->capacity ?
+				cs->capacity * 2 : COMMAND_STREAM_CHUNK;
+		char *buffer = malloc(capacity);
+
+		if (!buffer) return -ENOMEM;
+
+		if (cs->buffer) {
+			memcpy(buffer, cs->buffer, cs->end);
+			__rebase_tokens(&cs->tv, cs->buffer, buffer);
+			free(cs->buffer);
+		}
+		cs->buffer = buffer;
+		cs->capacity = capacity;
+	}
+
+	if (cs->wait && (nr_read = cs->wait(cs->fd))) return nr_read;
+
+	do {
+		nr_read = read(cs->fd, cs->buffer + cs->end,
+				cs->capacity - cs->end - 1);
+	} while (nr_read < 0 && errno == EINTR);
+
+	if (nr_read < 0) return -errno;
+	if (nr_read == 0) cs->eof = true;
+
+	cs->end += nr_read;
+	return 0;
+}
+
+int read_command(struct command_stream *cs)
+{
+	struct token_vector *tv = &cs->tv;
+	int ret = 0;
+
+	/* Start a new command after the one returned last time */
+	cs->begin = cs->cursor;
+	tv->nr_tokens = 0;
+	if (!tv->capacity && (ret = __grow_token_vector(tv))) return ret;
+
+	while (true) {
+		char *buffer = cs->buffer;
+
+		for (; cs->cursor < cs->end; cs->cursor++) {
+			char c = buffer[cs->cursor];
+
+			if (isspace(c)) {
+				buffer[cs->cursor] = '\0';
+				cs->in_token = false;
+				if (c == '\n') {
+					cs->in_comment = false;
+					cs->cursor++;
+					goto out;
+				}
+			} else if (!cs->in_token && !cs->in_comment) {
+				if (STRIP_COMMENTS && c == '#') {
+					cs->in_comment = true;
+					continue;
+				}
+				if ((ret = __push_token(tv, buffer + cs->cursor))) {
+					return ret;
+				}
+				cs->in_token = true;
+			}
+		}
+
+		if (cs->eof) {
+			if (cs->begin == cs->end) return 0;
+			/* The last command without the trailing newline */
+			buffer[cs->end] = '\0';
+			cs->in_token = cs->in_comment = false;
+			goto out;
+		}
+
+		if ((ret = __fill_command_stream(cs))) return ret;
+	}
+
+out:
+	tv->tokens[tv->nr_tokens] = NULL;
+	return 1;
+}
+
+
+/***********************************************************************
+ * Batch parser
+ */
+static void __classify_scalar(const char *block, struct block_class *c)
+{
+	c->space = c->newline = c->nul = 0;
+
+	for (int i = 0; i < BLOCK_SIZE; i++) {
+		if (isspace(block[i])) c->space |= 1ULL << i;
+		if (block[i] == '\n') c->newline |= 1ULL << i;
+		if (block[i] == '\0') c->nul |= 1ULL << i;
+	}
+}
+
+static int __grow(void *array, size_t *capacity, size_t nr, size_t size)
+{
+	void *new;
+	size_t new_capacity = *capacity ? *capacity * 2 : 1024;
+
+	if (nr < *capacity) return 0;
+
+	new = realloc(*(void **)array, new_capacity * size);
+	if (!new) return -ENOMEM;
+
+	*(void **)array = new;
+	*capacity = new_capacity;
+	return 0;
+}
+
+static int __add_line(struct parsed_file *pf)
+{
+	if (__grow(&pf->line_start, &pf->__lines_capacity,
+				pf->nr_lines + 1, sizeof(*pf->line_start))) {
+		return -ENOMEM;
+	}
+	pf->line_start[++pf->nr_lines] = pf->nr_tokens;
+	return 0;
+}
+
+static int __add_token(struct parsed_file *pf, size_t offset)
+{
+	size_t capacity = pf->__tokens_capacity;
+
+	if (__grow(&pf->token_offset, &capacity,
+				pf->nr_tokens, sizeof(*pf->token_offset)) ||
+		__grow(&pf->token_len, &pf->__tokens_capacity,
+				pf->nr_tokens, sizeof(*pf->token_len))) {
+		return -ENOMEM;
+	}
+	pf->token_offset[pf->nr_tokens++] = offset;
+	return 0;
+}
+
+/**
+ * Walk [@begin, @end) of @data in blocks as __parse_command_blocks() does, but
+ * visit token starts, token ends, and newlines in order to build the index.
+ * @begin must be the beginning of a line, and @data must be readable up to
+ * the BLOCK_SIZE-aligned end of @end. Token offsets are relative to @data
+ * whereas token indexes in @line_start[] are relative to the first token in
+ * the range.
+ */
+static int __index_blocks(struct parsed_file *pf, const char *data,
+		size_t begin, size_t end,
+		void (*classify)(const char *block, struct block_class *c))
+{
+	uint64_t valid = ~0ULL << (begin % BLOCK_SIZE);
+	uint64_t carry = 0;
+	bool in_token = false;	/* The current token is recorded in the index */
+	bool in_comment = false;
+
+	if (__grow(&pf->line_start, &pf->__lines_capacity,
+				0, sizeof(*pf->line_start))) {
+		return -ENOMEM;
+	}
+	pf->line_start[0] = 0;
+
+	for (size_t base = begin - begin % BLOCK_SIZE; base < end;
+			base += BLOCK_SIZE, valid = ~0ULL) {
+		struct block_class c;
+		uint64_t word, prev, starts, ends, events;
+
+		if (end - base < BLOCK_SIZE) {
+			valid &= (1ULL << (end - base)) - 1;
+		}
+
+		classify(data + base, &c);
+
+		word = ~c.space & valid;
+		prev = (word << 1) | carry;
+		starts = word & ~prev;
+		ends = ~word & prev;
+		c.newline &= valid;
+		carry = word >> (BLOCK_SIZE - 1);
+
+		events = starts | ends | c.newline;
+		while (events) {
+			unsigned int i = __builtin_ctzll(events);
+			uint64_t bit = 1ULL << i;
+			size_t pos = base + i;
+
+			events &= events - 1;
+
+			if ((ends & bit) && in_token) {
+				size_t t = pf->nr_tokens - 1;
+				pf->token_len[t] = pos - pf->token_offset[t];
+				in_token = false;
+			}
+
+			if (c.newline & bit) {
+				if (__add_line(pf)) return -ENOMEM;
+				in_comment = false;
+			}
+
+			if ((starts & bit) && !in_comment) {
+				if (STRIP_COMMENTS && data[pos] == '#') {
+					in_comment = true;
+					continue;
+				}
+				if (__add_token(pf, pos)) return -ENOMEM;
+				in_token = true;
+			}
+		}
+	}
+
+	/* The range does not end with a newline */
+	if (in_token) {
+		size_t t = pf->nr_tokens - 1;
+		pf->token_len[t] = end - pf->token_offset[t];
+	}
+	if (end > begin && data[end - 1] != '\n') {
+		if (__add_line(pf)) return -ENOMEM;
+	}
+
+	return 0;
+}
+
+
+/***********************************************************************
+ * Parallel batch parser
+ *
+ * The file is split into chunks which are indexed by their own threads, and
+ * the chunk indexes are concatenated afterwards. Every chunk boundary is moved
+ * forward to the beginning of the next line. A newline resets every state of
+ * the parser (in a token or in a comment), so each chunk is indexed from the
+ * initial state and no fix-up for the tokens across chunks is needed.
+ */
+#define PARSE_CHUNK_MIN		(4UL << 20)	/* Minimum bytes per thread */
+#define PARSE_THREADS_MAX	64
+
+struct parse_chunk {
+	pthread_t thread;
+	bool threaded;
+
+	const char *data;
+	size_t begin, end;
+
+	struct parsed_file index;	/* Index of this chunk */
+	int ret;
+
+	struct parsed_file *pf;		/* Index of the whole file */
+	size_t first_line;
+	size_t first_token;
+};
+
+static void *__index_chunk(void *arg)
+{
+	struct parse_chunk *chunk = arg;
+
+	chunk->ret = __index_blocks(&chunk->index, chunk->data,
+			chunk->begin, chunk->end,
+			__classify ? __classify : __classify_scalar);
+	return NULL;
+}
+
+static void *__merge_chunk(void *arg)
+{
+	struct parse_chunk *chunk = arg;
+	struct parsed_file *pf = chunk->pf;
+	struct parsed_file *index = &chunk->index;
+
+	for (size_t i = 0; i < index->nr_lines; i++) {
+		pf->line_start[chunk->first_line + i] =
+				chunk->first_token + index->line_start[i];
+	}
+	memcpy(pf->token_offset + chunk->first_token, index->token_offset,
+			sizeof(*index->token_offset) * index->nr_tokens);
+	memcpy(pf->token_len + chunk->first_token, index->token_len,
+			sizeof(*index->token_len) * index->nr_tokens);
+
+	return NULL;
+}
+
+static void __run_chunks(struct parse_chunk *chunks, int nr_chunks,
+		void *(*fn)(void *))
+{
+	/* The first chunk is run by the calling thread */
+	for (int i = 1; i < nr_chunks; i++) {
+		chunks[i].threaded =
+			pthread_create(&chunks[i].thread, NULL, fn, chunks + i) == 0;
+		if (!chunks[i].threaded) fn(chunks + i);
+	}
+	if (nr_chunks > 0) fn(chunks);
+
+	for (int i = 1; i < nr_chunks; i++) {
+		if (chunks[i].threaded) pthread_join(chunks[i].thread, NULL);
+	}
+}
+
+static int __index_parallel(struct parsed_file *pf, int nr_threads)
+{
+	struct parse_chunk chunks[PARSE_THREADS_MAX] = { 0 };
+	int nr_chunks = 0;
+	size_t begin = 0;
+	int ret = 0;
+
+	/* Split the file into chunks, each of which ends right after a newline */
+	for (int i = 1; i <= nr_threads && begin < pf->size; i++) {
+		size_t end = i == nr_threads ? pf->size : pf->size / nr_threads * i;
+		const char *newline;
+
+		if (end < begin) end = begin;
+		newline = memchr(pf->data + end, '\n', pf->size - end);
+		end = newline ? newline - pf->data + 1 : pf->size;
+
+		chunks[nr_chunks++] = (struct parse_chunk) {
+			.data = pf->data, .begin = begin, .end = end, .pf = pf,
+		};
+		begin = end;
+	}
+
+	__run_chunks(chunks, nr_chunks, __index_chunk);
+
+	for (int i = 0; i < nr_chunks; i++) {
+		if (chunks[i].ret) {
+			ret = chunks[i].ret;
+			goto out;
+		}
+		chunks[i].first_line = pf->nr_lines;
+		chunks[i].first_token = pf->nr_tokens;
+		pf->nr_lines += chunks[i].index.nr_lines;
+		pf->nr_tokens += chunks[i].index.nr_tokens;
+	}
+
+	pf->line_start = malloc(sizeof(*pf->line_start) * (pf->nr_lines + 1));
+	pf->token_offset = malloc(sizeof(*pf->token_offset) * (pf->nr_tokens + 1));
+	pf->token_len = malloc(sizeof(*pf->token_len) * (pf->nr_tokens + 1));
+	if (!pf->line_start || !pf->token_offset || !pf->token_len) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	pf->__lines_capacity = pf->nr_lines + 1;
+	pf->__tokens_capacity = pf->nr_tokens;
+
+	__run_chunks(chunks, nr_chunks, __merge_chunk);
+	pf->line_start[pf->nr_lines] = pf->nr_tokens;
+
+out:
+	for (int i = 0; i < nr_chunks; i++) {
+		free_parsed_file(&chunks[i].index);
+	}
+	return ret;
+}
+
+
+/**
+ * Map the file with a trailing '\0' byte. The file is mapped over an
+ * anonymous mapping one byte larger than the file, so the byte after the file
+ * is readable even when the file size is a multiple of the page size.
+ */
+static int __map_file(int fd, struct parsed_file *pf)
+{
+	struct stat st;
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	void *data;
+
+	if (fstat(fd, &st) < 0) return -errno;
+	if (!S_ISREG(st.st_mode)) return -EINVAL;
+
+	pf->size = st.st_size;
+	pf->map_size = (pf->size + 1 + page_size - 1) & ~(page_size - 1);
+
+	data = mmap(NULL, pf->map_size, PROT_READ,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (data == MAP_FAILED) return -errno;
+
+	if (pf->size && mmap(data, pf->size, PROT_READ,
+				MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+		int ret = -errno;
+		munmap(data, pf->map_size);
+		return ret;
+	}
+	madvise(data, pf->size, MADV_SEQUENTIAL);
+
+	pf->data = data;
+	return 0;
+}
+
+int parse_fd_parallel(int fd, struct parsed_file *pf, int nr_threads)
+{
+	int ret;
+
+	memset(pf, 0x00, sizeof(*pf));
+
+	ret = __map_file(fd, pf);
+	if (ret) return ret;
+
+	if (nr_threads <= 0) {
+		nr_threads = sysconf(_SC_NPROCESSORS_ONLN);
+		if (nr_threads > pf->size / PARSE_CHUNK_MIN) {
+			nr_threads = pf->size / PARSE_CHUNK_MIN;
+		}
+	}
+	if (nr_threads > PARSE_THREADS_MAX) nr_threads = PARSE_THREADS_MAX;
+
+	/* An empty file has nothing to split */
+	if (nr_threads > 1 && pf->size) {
+		ret = __index_parallel(pf, nr_threads);
+	} else {
+		ret = __index_blocks(pf, pf->data, 0, pf->size,
+				__classify ? __classify : __classify_scalar);
+	}
+	if (ret) free_parsed_file(pf);
+
+	return ret;
+}
+
+int parse_fd(int fd, struct parsed_file *pf)
+{
+	return parse_fd_parallel(fd, pf, 0);
+}
+
+int parse_file(const char *filename, struct parsed_file *pf)
+{
+	int ret;
+	int fd = open(filename, O_RDONLY);
+
+	if (fd < 0) return -errno;
+
+	ret = parse_fd(fd, pf);
+	close(fd);
+
+	return ret;
+}
+
+void free_parsed_file(struct parsed_file *pf)
+{
+	if (pf->data) munmap((void *)pf->data, pf->map_size);
+
+	free(pf->line_start);
+	free(pf->token_offset);
+	free(pf->token_len);
+
+	memset(pf, 0x00, sizeof(*pf));
 }
@@ -24,6 +24,7 @@
 
 #include "types.h"
 #include "parser.h"
+#include "keywords.h"
 
 #include "list_head.h"
 #include "vm.h"
@@ -166,9 +167,8 @@ static bool __access_memory(unsigned int vpn, unsigned int rw)
 	return ret;
 }
 
-static unsigned int __make_rwflag(const char *rw)
+static unsigned int __make_rwflag(const char *rw, size_t len)
 {
-	int len = strlen(rw);
 	unsigned int rwflag = 0;
 
 	for (int i = 0; i < len; i++) {
@@ -271,73 +271,126 @@ static void __print_help(void)
 	printf("\n");
 }
 
-static bool strmatch(char * const str, const char *expect)
+/**
+ * Run a command. Return false to stop the simulation.
+ */
+static bool __do_command(int nr_tokens, const char *tokens[], const size_t lens[])
 {
-	return (strlen(str) == strlen(expect)) &&
-			(strncmp(str, expect, strlen(expect)) == 0);
+	enum keyword command = keyword_lookup(tokens[0], lens[0]);
+
+	if (nr_tokens == 1) {
+		switch (command) {
+		case KW_EXIT:
+			return false;
+		case KW_SHOW:
+			__show_pagetable();
+			break;
+		case KW_PAGES:
+			__show_pageframes();
+			break;
+		case KW_HELP:
+			__print_help();
+			break;
+		default:
+			printf("Unknown command %.*s\n", (int)lens[0], tokens[0]);
+			break;
+		}
+	} else if (nr_tokens == 2) {
+		unsigned int arg = strtoimax(tokens[1], NULL, 0);
+
+		switch (command) {
+		case KW_SWITCH:
+			switch_process(arg);
+			break;
+		case KW_FREE:
+			__free_page(arg);
+			break;
+		case KW_READ:
+			__access_memory(arg, RW_READ);
+			break;
+		case KW_WRITE:
+			__access_memory(arg, RW_WRITE);
+			break;
+		default:
+			printf("Unknown command %.*s\n", (int)lens[0], tokens[0]);
+			break;
+		}
+	} else if (nr_tokens == 3) {
+		unsigned int vpn = strtoimax(tokens[1], NULL, 0);
+		unsigned int rw = __make_rwflag(tokens[2], lens[2]);
+
+		switch (command) {
+		case KW_ALLOC:
+			if (!__alloc_page(vpn, rw)) return false;
+			break;
+		case KW_ACCESS:
+			__access_memory(vpn, rw);
+			break;
+		default:
+			printf("Unknown command %.*s\n", (int)lens[0], tokens[0]);
+			break;
+		}
+	} else {
+		assert(!"Unknown command in trace");
+	}
+
+	if (verbose) printf(">> ");
+
+	return true;
 }
 
 static void __do_simulation(FILE *input)
 {
 	char command[MAX_COMMAND_LEN] = { 0 };
+	struct token_vector tv = { NULL };
 
 	__init_system();
 
 	while (fgets(command, sizeof(command), input)) {
-		char *tokens[MAX_NR_TOKENS] = { NULL };
-		int nr_tokens = 0;
+		size_t lens[3];
 
 		/* Make the command lowercase */
 		for (size_t i = 0; i < strlen(command); i++) {
 			command[i] = tolower(command[i]);
 		}
 
-		if (parse_command(command, &nr_tokens, tokens) < 0) {
+		if (parse_command_vector(command, &tv) < 0) {
 			continue;
 		}
+		if (tv.nr_tokens == 0) continue;
+
+		for (int i = 0; i < tv.nr_tokens && i < 3; i++) {
+			lens[i] = strlen(tv.tokens[i]);
+		}
+
+		if (!__do_command(tv.nr_tokens, (const char **)tv.tokens, lens)) break;
+	}
+
+	free(tv.tokens);
+}
+
+/**
+ * Run the workload from the token index of the whole workload file. Commands
+ * are matched case-insensitively instead of making the file lowercase.
+ */
+static void __do_simulation_batch(const struct parsed_file *workload)
+{
+	__init_system();
+
+	for (size_t line = 0; line < workload->nr_lines; line++) {
+		size_t t = workload->line_start[line];
+		int nr_tokens = workload->line_start[line + 1] - t;
+		const char *tokens[3];
+		size_t lens[3];
+
 		if (nr_tokens == 0) continue;
 
-		if (nr_tokens == 1) {
-			if (strmatch(tokens[0], "exit")) break;
-			if (strmatch(tokens[0], "show")) {
-				__show_pagetable();
-			} else if (strmatch(tokens[0], "pages")) {
-				__show_pageframes();
-			} else if (strmatch(tokens[0], "help") || strmatch(tokens[0], "?")) {
-				__print_help();
-			} else {
-				printf("Unknown command %s\n", tokens[0]);
-			}
-		} else if (nr_tokens == 2) {
-			unsigned int arg = strtoimax(tokens[1], NULL, 0);
-
-			if (strmatch(tokens[0], "switch") || strmatch(tokens[0], "s")) {
-				switch_process(arg);
-			} else if (strmatch(tokens[0], "free") || strmatch(tokens[0], "f")) {
-				__free_page(arg);
-			} else if (strmatch(tokens[0], "read") || strmatch(tokens[0], "r")) {
-				__access_memory(arg, RW_READ);
-			} else if (strmatch(tokens[0], "write") || strmatch(tokens[0], "w")) {
-				__access_memory(arg, RW_WRITE);
-			} else {
-				printf("Unknown command %s\n", tokens[0]);
-			}
-		} else if (nr_tokens == 3) {
-			unsigned int vpn = strtoimax(tokens[1], NULL, 0);
-			unsigned int rw = __make_rwflag(tokens[2]);
-
-			if (strmatch(tokens[0], "alloc") || strmatch(tokens[0], "a")) {
-				if (!__alloc_page(vpn, rw)) break;
-			} else if (strmatch(tokens[0], "access")) {
-				__access_memory(vpn, rw);
-			} else {
-				printf("Unknown command %s\n", tokens[0]);
-			}
-		} else {
-			assert(!"Unknown command in trace");
+		for (int i = 0; i < nr_tokens && i < 3; i++) {
+			tokens[i] = parsed_token(workload, t + i);
+			lens[i] = workload->token_len[t + i];
 		}
 
-		if (verbose) printf(">> ");
+		if (!__do_command(nr_tokens, tokens, lens)) break;
 	}
 }
 
@@ -352,6 +405,7 @@ int main(int argc, char * argv[])
 {
 	int opt;
 	FILE *input = stdin;
+	struct parsed_file workload;
 
 	while ((opt = getopt(argc, argv, "qh")) != -1) {
 		switch (opt) {
@@ -397,7 +451,12 @@ int main(int argc, char * argv[])
 		printf(">> ");
 	}
 
-	__do_simulation(input);
+	if (parse_fd(fileno(input), &workload) == 0) {
+		__do_simulation_batch(&workload);
+		free_parsed_file(&workload);
+	} else {
+		__do_simulation(input);
+	}
 
 	if (input != stdin) fclose(input);
 